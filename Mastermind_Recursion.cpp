@@ -11,747 +11,6246 @@
 #include <cstdlib>   // Random Function Library
 #include <ctime>     // Time Library
 #include <string>
+#include <string_view>
+#include <charconv>  // from_chars
 #include <set>
 #include <list>
 #include <stack>
 #include <queue>
 #include <map>
+#include <unordered_map>
+#include <deque>
 #include <vector>
 #include <utility>
+#include <cstring>
+#include <sstream>
+#include <fstream>
 #include <algorithm>
+#include <cstdint>
+#include <cstdio>    // rename
+#include <cmath>
+#include <numeric>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <new>
+#include <fcntl.h>     // open
+#include <sys/mman.h>  // mmap
+#include <sys/stat.h>  // fstat
+#include <unistd.h>    // write, ftruncate, fsync
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <csignal>
+#include <cerrno>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <streambuf>
+#include <array>
 using namespace std;
 
-/************************************************************
-*    Holds the result of a single game of Mastermind, 
-*    including game settings and outcome.
- ***********************************************************/
-struct GameResult {
-    int codeLength;
-    char duplicateSetting;
-    bool isWin; // true if user won, false if lost
-    GameResult(int len, char dup, bool win)  {
-        codeLength = len; 
-        duplicateSetting = dup; 
-        isWin = win;
-    }
-};
+const int numTurns = 10;    // Turns the guesser gets on boards up to 8x8
+const int maxPegs = 15;     // Longest code
+const int maxColors = 16;   // Most colors, shown as 1-9 then A-G
+const int numBoards = maxPegs * maxColors * 2;  // Distinct board settings
+
+// Turns the guesser gets on a board; larger boards get more
+inline int turnLimit(int length, int colors) {
+    return max(numTurns, length + colors - 6);
+}
 
 /************************************************************
-*    A struct representing a node in a binary search tree, 
-*    where each node stores a game result and has pointers 
-*    to its left and right children to store and organize 
-*    game results for efficient retrieval and manipulation.
+*    Dense index of a board setting (code length, number of 
+*    colors and duplicate choice), used as the key of every 
+*    per-setting table.
 ***********************************************************/
-struct TreeNode {
-    GameResult result;
-    TreeNode* left;
-    TreeNode* right;
-    TreeNode(GameResult gr) : result(gr){
-        this->left = nullptr;
-        this->right = nullptr;
-    }
-};
-
-//Function prototypes
-void setupGame();
-char getDuplicateChoice();
-int getCodeLength();
-void genCode(int, list<char>&, char);
-void genNums(int, list<char>&, deque<char>&, set<char>&, char);
-void printCode(const list<char>&);
-void hint(const list<char>&, const list<char>&);
-void hint_recursive(const list<char>&, const list<char>&, map<char, int>&, int, 
-                    int, auto, auto);
-void hint_recursive_misplaced(const list<char>&, const list<char>&, 
-                              map<char, int>&, int, int, auto, auto);
-void showGameOverMessage(const list<char>&);
-void showInstructions();
-void validInput(const string&, bool&, const int&);
-void compareGuess(list<char>&, const string&, const list<char>&, bool&, 
-                  stack<int>&, const int&, const char&, TreeNode*&);
-void exitingGame(bool&);
-void newGame(char&);
-void recordResult(int, char, bool, TreeNode*&);
-void displayStatistics(TreeNode*);
-void printWelcome();
-void printGameOver();
-void insert(TreeNode*&, GameResult);
-void printInOrder(TreeNode*);
-void extractScores(TreeNode*, vector<pair<string, int>>&);
-void merge(vector<pair<string, int>>&, int, int, int);
-void mergeSort(vector<pair<string, int>>&, int, int);
-void printSortedScores(TreeNode*);
-unsigned int RSHash(const list<char>);
+inline int boardIndex(int length, int colors, char choiceDuplicate) {
+    return ((length - 1) * maxColors + (colors - 1)) * 2 + 
+           (tolower(choiceDuplicate) == 'y');
+}
 
 /************************************************************
-*    A Hash Table implementation using chaining for collision 
-*    resolution, designed to handle keys represented as 
-*    `list<char>` objects.
+*    Whether a code length, number of colors and duplicate 
+*    choice ('y' or 'n') make a board this program can play. 
+*    Without duplicates every peg needs a color of its own.
 ***********************************************************/
-class HashTable {
-private:
-    vector<list<list<char>>> table; // Array of linked lists for chaining
-    int size;                   // Number of buckets
+inline bool validBoard(int length, int colors, char choiceDuplicate) {
+    return length >= 1 && length <= maxPegs && colors >= 2 && 
+           colors <= maxColors && 
+           (choiceDuplicate == 'y' || choiceDuplicate == 'n') && 
+           (choiceDuplicate == 'y' || colors >= length);
+}
 
-    // Compute the index using RSHash and modulus operation
-    int computeIndex(const list<char> key) const {
-        return RSHash(key) % size;
+/************************************************************
+*    Number of different codes on a board: colors^length with 
+*    duplicates, colors!/(colors - length)! without.
+***********************************************************/
+inline uint64_t codeSpace(int length, int colors, char choiceDuplicate) {
+    bool allowDuplicates = tolower(choiceDuplicate) == 'y';
+    uint64_t total = 1;
+    for (int i = 0; i < length; i++) {
+        total *= allowDuplicates ? colors : colors - i;
     }
+    return total;
+}
 
-public:
-    // Constructor
-    HashTable(int tableSize) {
-        this->size = tableSize;
-        table.resize(size);
+/************************************************************
+*    A compact, trivially copyable Mastermind code. Up to 15 
+*    pegs of 4 bits each (0-15 for the symbols '1'-'9' and 
+*    'A'-'G') are packed into the low 60 bits of a single 
+*    `uint64_t`, and the number of pegs is kept in the top 4 
+*    bits.
+***********************************************************/
+struct Code {
+    uint64_t bits;
+    
+    Code() {
+        bits = 0;
     }
     
-    // Get the size of the hash table
-    int getSize() const {
-        return size;
+    // Number of pegs in the code
+    int size() const {
+        return static_cast<int>(bits >> 60);
     }
     
-    // Get a bucket at a specific index
-    const list<list<char>>& getBucket(int index) const {
-        return table[index];
+    // Peg value (0-15) at position `i`
+    int peg(int i) const {
+        return (bits >> (4 * i)) & 15;
     }
     
-    // Insert a key into the hash table
-    void insert(const list<char>& key) {
-        int index = computeIndex(key);
-        table[index].push_back(key);
+    // Symbol ('1'-'9', 'A'-'G') at position `i`
+    char digit(int i) const {
+        return symbol(peg(i));
     }
-        // Search for a key in the hash table
-    bool search(const list<char>& key) const {
-        int index = computeIndex(key);
-        for (const auto &val : table[index]) {
-            if (val == key) {
-                return true;
-            }
+    
+    // Symbol typed for peg value `peg`
+    static char symbol(int peg) {
+        return peg < 9 ? '1' + peg : 'A' + (peg - 9);
+    }
+    
+    // Peg value of a typed symbol (either case), or -1 if it is none
+    static int pegValue(char symbol) {
+        if (symbol >= '1' && symbol <= '9') {
+            return symbol - '1';
         }
-        return false;
+        symbol |= 0x20;     // Lower case
+        return (symbol >= 'a' && symbol <= 'g') ? symbol - 'a' + 9 : -1;
+    }
+    
+    // Append a symbol at the end of the code
+    void push_back(char digit) {
+        bits |= static_cast<uint64_t>(pegValue(digit) & 15) << (4 * size());
+        bits += 1ull << 60;
+    }
+    
+    void clear() {
+        bits = 0;
+    }
+    
+    // Build a code from the typed digits, e.g. "1234"
+    static Code fromString(string_view digits) {
+        Code code;
+        for (char ch : digits) {
+            code.push_back(ch);
+        }
+        return code;
+    }
+    
+    // Convert the code back to its typed digits
+    string toString() const {
+        string digits(size(), '1');
+        for (int i = 0; i < size(); i++) {
+            digits[i] = digit(i);
+        }
+        return digits;
+    }
+    
+    bool operator==(const Code& other) const {
+        return bits == other.bits;
+    }
+    
+    bool operator!=(const Code& other) const {
+        return bits != other.bits;
     }
 };
 
-void printHashTable(const HashTable&);
-
-int main() 
-{
-    queue<GameResult> resultsQueue;
-    char playAgain = 'y';    
-    list<char> code;
-    list<char> guess;
-    char choiceDuplicate;
-    int length;
-    stack<int> turns;
-    const int numTurns = 10;
-    string guess_input;
-    bool quit = false;
-    TreeNode* resultsTree = nullptr;
-    const int tableSize = 8;
-    
-    HashTable hashTable(tableSize);
+/************************************************************
+*    The score of a guess against a code: `black` pegs are 
+*    right digits in the right position (the hint's 'O's) 
+*    and `white` pegs are right digits in the wrong position 
+*    (the hint's 'X's).
+***********************************************************/
+struct Feedback {
+    uint8_t black;
+    uint8_t white;
     
-    setupGame();    //Setting up the random function
-    printWelcome();
+    bool operator==(const Feedback& other) const {
+        return black == other.black && white == other.white;
+    }
     
-    do {
-        bool endGame = false;
-        bool skipTurn = false; // Flag to skip the turn without using `continue`
-        playAgain = tolower(playAgain);
-        
-        if(playAgain == 'y') {
-            for (int i = 1; i <= numTurns; i++){
-                turns.push(i);
-            }
-            
-            // Get valid code length
-            length = getCodeLength();
+    bool operator!=(const Feedback& other) const {
+        return !(*this == other);
+    }
+};
 
-            // Get valid choice for duplicates
-            choiceDuplicate = getDuplicateChoice();
+/************************************************************
+*    A seedable PCG32 random number generator that draws
+*    secret codes. Generators built with the same seed but
+*    different `stream` numbers produce independent
+*    sequences, so each thread can own one. With duplicates
+*    every peg is a random color (plain random bits when the
+*    number of colors is a power of two); without, the pegs
+*    come from a partial Fisher-Yates shuffle of the colors.
+*    Neither path loops or recurses more than once per peg.
+***********************************************************/
+class CodeGenerator {
+private:
+    uint64_t state;
+    uint64_t increment;     // Selects the stream; always odd
 
-            genCode(length, code, choiceDuplicate);
-            hashTable.insert(code);
-//            cout << "\t\tCODE: ";
-//            printCode(code);
-            cout << "\nWrite a code using the numbers from 1 to 8. You have 10 "
-                    "turns to guess the code.\n";
+public:
+    // Constructor
+    CodeGenerator(uint64_t seed = 0, uint64_t stream = 0) {
+        setSeed(seed, stream);
+    }
 
-            while (!endGame && !turns.empty() && !quit) {    
-                skipTurn = false; // Reset skipTurn flag at the start of each turn
-                cout << "Type 'exit' anytime to quit the game." << endl;
-                cout << "Type 'tutorial' to see game's instructions." << endl;
-                cout << "\nGuess: ";
-                cin >> guess_input;
+    // Restart the sequence for `seed` on the given stream
+    void setSeed(uint64_t seed, uint64_t stream = 0) {
+        state = 0;
+        increment = (stream << 1) | 1;
+        next();
+        state += seed;
+        next();
+    }
 
-                // Check for exit command
-                if (guess_input == "exit") {
-                    exitingGame(quit);
-                    skipTurn = true; // Skip rest of the loop for re-confirmation
-                }
-                
-                if (guess_input == "tutorial") {
-                    showInstructions();
-                    skipTurn = true;
-                }
+    // Next 32 random bits
+    uint32_t next() {
+        uint64_t old = state;
+        state = old * 6364136223846793005ull + increment;
+        uint32_t xorShifted = static_cast<uint32_t>(((old >> 18) ^ old) >> 27);
+        uint32_t rot = static_cast<uint32_t>(old >> 59);
+        return (xorShifted >> rot) | (xorShifted << ((32 - rot) & 31));
+    }
 
-                // First try-catch block: Check guess input
-                if(!skipTurn){
-                    validInput(guess_input, skipTurn, length);
-                }
+    // Random number in [0, bound); the bias is below 2^-28 for bound <= 16
+    uint32_t below(uint32_t bound) {
+        return static_cast<uint32_t>((static_cast<uint64_t>(next()) * bound) >> 32);
+    }
 
-                // Clear the previous guess and add the new one from input
-                if(!skipTurn){
-                    compareGuess(guess, guess_input, code, endGame, turns, 
-                                 length, choiceDuplicate, resultsTree);
+    // Draw one secret code
+    Code generate(int length, int colors, char choice) {
+        Code code;
+        if (tolower(choice) == 'y') {
+            if ((colors & (colors - 1)) == 0) {
+                // Power of two: each peg takes log2(colors) random bits
+                int width = __builtin_ctz(colors);
+                uint64_t random = next();
+                if (width * length > 32) {
+                    random |= static_cast<uint64_t>(next()) << 32;
+                }
+                for (int i = 0; i < length; i++) {
+                    code.bits |= ((random >> (width * i)) & (colors - 1)) << (4 * i);
+                }
+            } else {
+                for (int i = 0; i < length; i++) {
+                    code.bits |= static_cast<uint64_t>(below(colors)) << (4 * i);
                 }
             }
+            code.bits |= static_cast<uint64_t>(length) << 60;
+            return code;
+        }
 
-            if (!quit) {
-                showGameOverMessage(code);
-                displayStatistics(resultsTree);
-                printSortedScores(resultsTree);  //Statistics after each game
-                printHashTable(hashTable);
-                newGame(playAgain);
-            }
+        uint8_t digits[maxColors] = {0, 1, 2, 3, 4, 5, 6, 7, 
+                                     8, 9, 10, 11, 12, 13, 14, 15};
+        for (int i = 0; i < length; i++) {
+            int j = i + below(colors - i);
+            swap(digits[i], digits[j]);
+            code.bits |= static_cast<uint64_t>(digits[i]) << (4 * i);
         }
-        code.clear();
-    } while (playAgain == 'y' && !quit);
+        code.bits |= static_cast<uint64_t>(length) << 60;
+        return code;
+    }
 
-    return 0;
-}
+    // Draw `n` secret codes into `out`
+    void generate(int length, int colors, char choice, Code* out, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            out[i] = generate(length, colors, choice);
+        }
+    }
+};
 
-/************************************************************
-*    Generates a random code for the Mastermind game based on
-*    the specified length and duplicate setting.
- ***********************************************************/
-void genCode(int length, list<char>& code, char choice) {
-    set<char> unique_numbers;
-    deque<char> numbers = {'1', '2', '3', '4', '5', '6', '7', '8'};
-    
-    genNums(length, code, numbers, unique_numbers, choice);
-}
+CodeGenerator codeGenerator;    // Draws the secret codes of every game
 
 /************************************************************
-*    Generates a random sequence of numbers for a Mastermind 
-*    game code using recursion. Handles both 
-*    duplicate-allowed and duplicate-restricted scenarios.
+*    Per-field minimum of two vectors of `fieldBits`-bit 
+*    fields whose top bits (set in `highBits`) are all clear. 
+*    Setting the top bit of every field of `a` before the 
+*    subtraction keeps borrows from crossing fields.
 ***********************************************************/
-void genNums(int length, list<char>& code, deque<char>& numbers, 
-             set<char>& unique_numbers, char choice) {
-    // Base case: If the desired length is reached, stop recursion.
-    if (code.size() == length) {
-        return;
-    }
-
-    // Shuffle the deque to randomize the selection.
-    random_shuffle(numbers.begin(), numbers.end());
-
-    // Get the first number from the shuffled deque.
-    char num = numbers.front();
-
-    // Check if duplicates are allowed or the number is unique.
-    if (toupper(choice) == 'Y' || unique_numbers.find(num) == unique_numbers.end()) {
-        code.push_back(num);
-        unique_numbers.insert(num);
-    }
-
-    // Recursive call with reduced length.
-    genNums(length, code, numbers, unique_numbers, choice);
+static inline uint64_t fieldMin(uint64_t a, uint64_t b, uint64_t highBits, 
+                                int fieldBits) {
+    uint64_t geq = ((a | highBits) - b) & highBits;   // a >= b, per field
+    uint64_t mask = (geq >> (fieldBits - 1)) * ((1ull << fieldBits) - 1);
+    return (b & mask) | (a & ~mask);
 }
 
-/************************************************************
-*    Displays the generated code sequence by printing each 
-*    character in the code list.
- ***********************************************************/
-void printCode(const list<char>& code) {
-    for (char num : code) {
-        cout << num;
-    }
-    cout << endl;
+// Number of 4-bit fields of `bits` holding 1 (the rest hold 0); the 
+// multiply adds every field into the top one, and at most 15 are set
+static inline int countFields(uint64_t bits) {
+    return static_cast<int>((bits * 0x1111111111111111ull) >> 60);
 }
 
 /************************************************************
-*    Generates and processes a hint for a Mastermind game 
-*    guess using recursion. The function calculates and 
-*    tracks the number of digits in the correct position 
-*    (`correct`) and unmatched code digits for later 
-*    misplaced digit analysis. Delegates misplaced digit 
-*    analysis to `hint_recursive_misplaced`.
+*    Pegs two codes share by color: the sum over colors of 
+*    the smaller of both counts. Counts are 4-bit fields, one 
+*    per color. Codes shorter than 8 pegs never count 8 of a 
+*    color, so all 16 fields are compared at once; otherwise 
+*    the even and odd colors are spread into bytes first.
 ***********************************************************/
-void hint_recursive(const list<char>& code, const list<char>& guess, 
-                    map<char, int>& code_count, int correct, int misplaced, 
-                    auto code_it, auto guess_it) {
-    if (code_it == code.end()) {
-        // Base case
-        guess_it = guess.begin();
-        code_it = code.begin();
-        hint_recursive_misplaced(code, guess, code_count, correct, misplaced, 
-                                 code_it, guess_it);
-        return;
-    }
-    
-    // Process one element: Check if the current code and guess match at the same position
-    if (*code_it == *guess_it) {
-        correct++;  // Increment correct count for each matching position
+static inline int commonColors(uint64_t guessCounts, uint64_t codeCounts, 
+                               bool smallCounts) {
+    const uint64_t lowNibbles = 0x0F0F0F0F0F0F0F0Full;
+    uint64_t minCounts;
+    if (smallCounts) {
+        uint64_t m = fieldMin(guessCounts, codeCounts, 0x8888888888888888ull, 4);
+        minCounts = (m & lowNibbles) + ((m >> 4) & lowNibbles);
     } else {
-        code_count[*code_it]++;  // Track unmatched code digits for misplaced checking
+        const uint64_t highBits = 0x8080808080808080ull;
+        minCounts = fieldMin(guessCounts & lowNibbles, codeCounts & lowNibbles, 
+                             highBits, 8) + 
+                    fieldMin((guessCounts >> 4) & lowNibbles, 
+                             (codeCounts >> 4) & lowNibbles, highBits, 8);
     }
-
-    // Move to the next characters
-    hint_recursive(code, guess, code_count, correct, misplaced, ++code_it, ++guess_it);
+    return static_cast<int>((minCounts * 0x0101010101010101ull) >> 56);
 }
 
 /************************************************************
-*    Generates and prints a hint for a Mastermind game guess 
-*    using recursion. The hint shows:
-*      - 'O' for correct digits in correct positions.
-*      - 'X' for correct digits in incorrect positions.
-*      - '_' for incorrect digits.
+*    The game's scoring, checking and drawing of codes, 
+*    compiled separately for each code length and duplicate 
+*    setting. With the length fixed, every loop has a 
+*    constant trip count and unrolls, and the hint text for 
+*    every possible feedback is built at compile time. The 
+*    number of colors only matters when checking and drawing 
+*    codes, so it is passed in at run time.
 ***********************************************************/
-void hint_recursive_misplaced(const list<char>& code, const list<char>& guess, 
-                              map<char, int>& code_count, int correct, 
-                              int misplaced, auto code_it, auto guess_it) {
-    if (guess_it == guess.end()) {
-        // Base case: If we've processed all guesses, print the hint result
-        string hint_result(correct, 'O');   // Add all 'O's for correct positions
-        hint_result += string(misplaced, 'X'); // Add all 'X's for misplaced digits
-        hint_result += string(code.size() - correct - misplaced, '_'); // Add all '_'s for incorrect digits
-        cout << "Hint: " << hint_result << endl;
-        return;
+template <int Length, bool Duplicates>
+struct Engine {
+    static_assert(Length >= 1 && Length <= maxPegs, "codes hold at most 15 pegs");
+    
+    static constexpr uint64_t pegMask = (1ull << (4 * Length)) - 1;
+    static constexpr uint64_t lowBits = 0x1111111111111111ull & pegMask; // Bit 0 of each peg
+    static constexpr int numFeedbacks = (Length + 1) * (Length + 1);
+    
+    // Hint text for feedback index black * (Length + 1) + white
+    using HintTable = array<array<char, Length + 1>, numFeedbacks>;
+    
+    static constexpr HintTable makeHints() {
+        HintTable table = {};
+        for (int black = 0; black <= Length; black++) {
+            for (int white = 0; white <= Length; white++) {
+                array<char, Length + 1>& text = table[black * (Length + 1) + white];
+                for (int i = 0; i < Length; i++) {
+                    text[i] = (i < black) ? 'O' : (i < black + white) ? 'X' : '_';
+                }
+                text[Length] = '\0';
+            }
+        }
+        return table;
     }
-
-    // Check for misplaced digits
-    if (*code_it != *guess_it) {
-        auto found = find(code.begin(), code.end(), *guess_it); // Search for the guess in the rest of the code
-        if (code_count[*found] > 0) {
-            misplaced++; // Increment misplaced count if digit is in the wrong position
-            code_count[*found]--; // Decrement count to avoid double-counting
+    
+    static constexpr HintTable hints = makeHints();
+    
+    static uint64_t colorCounts(uint64_t bits) {
+        uint64_t counts = 0;
+        for (int i = 0; i < Length; i++) {
+            counts += 1ull << (4 * ((bits >> (4 * i)) & 15));
         }
+        return counts;
     }
     
-    // Move to the next characters
-    hint_recursive_misplaced(code, guess, code_count, correct, misplaced, 
-                             ++code_it, ++guess_it);
-}
+    static Feedback scoreCounts(uint64_t guessBits, uint64_t guessCounts, 
+                                uint64_t codeBits) {
+        uint64_t diff = (guessBits ^ codeBits) & pegMask;
+        diff = (diff | (diff >> 1) | (diff >> 2) | (diff >> 3)) & lowBits;
+        int black = Length - countFields(diff);
+        int common = commonColors(guessCounts, colorCounts(codeBits), Length < 8);
+        
+        Feedback fb;
+        fb.black = static_cast<uint8_t>(black);
+        fb.white = static_cast<uint8_t>(common - black);
+        return fb;
+    }
+    
+    static Feedback score(const Code& guess, const Code& code) {
+        return scoreCounts(guess.bits, colorCounts(guess.bits), code.bits);
+    }
+    
+    static void scoreBatch(const Code& guess, const Code* codes, size_t n, 
+                           Feedback* out) {
+        uint64_t guessCounts = colorCounts(guess.bits);
+        for (size_t i = 0; i < n; i++) {
+            out[i] = scoreCounts(guess.bits, guessCounts, codes[i].bits);
+        }
+    }
+    
+    // Whether `input` is exactly Length symbols of the first `colors` colors
+    static bool valid(string_view input, int colors) {
+        if (input.size() != Length) {
+            return false;
+        }
+        bool ok = true;
+        for (int i = 0; i < Length; i++) {
+            unsigned peg = static_cast<unsigned>(Code::pegValue(input[i]));
+            ok &= peg < static_cast<unsigned>(colors);
+        }
+        return ok;
+    }
+    
+    static Code generate(CodeGenerator& generator, int colors) {
+        return generator.generate(Length, colors, Duplicates ? 'y' : 'n');
+    }
+    
+    static const char* hint(const Feedback& fb) {
+        return hints[fb.black * (Length + 1) + fb.white].data();
+    }
+};
 
 /************************************************************
-*    Generates a hint to guide the player by indicating 
-*    the number of correct and misplaced digits in the guess.
- ***********************************************************/
-void hint(const list<char>& code, const list<char>& guess) {
-    map<char, int> code_count;
-    int correct = 0;     // Counts correct positions (O's)
-    int misplaced = 0;   // Counts misplaced digits (X's)
+*    The entry points of one `Engine` instantiation, so the 
+*    right one can be picked once per game from the runtime 
+*    settings.
+***********************************************************/
+struct EngineOps {
+    Feedback (*score)(const Code&, const Code&);
+    void (*scoreBatch)(const Code&, const Code*, size_t, Feedback*);
+    bool (*valid)(string_view, int);
+    Code (*generate)(CodeGenerator&, int);
+    const char* (*hint)(const Feedback&);
+};
 
-    // Start recursive function to process code and guess
-    hint_recursive(code, guess, code_count, correct, misplaced, code.begin(), 
-                   guess.begin());
+template <int Length, bool Duplicates>
+constexpr EngineOps engineOps() {
+    typedef Engine<Length, Duplicates> E;
+    return EngineOps{&E::score, &E::scoreBatch, &E::valid, &E::generate, &E::hint};
 }
 
-/************************************************************
-*    Initializes the random number generator with the current 
-*    time to ensure different random sequences in each game.
- ***********************************************************/
-void setupGame(){
-    srand(static_cast<unsigned int>(time(0)));
+// Engines for every length, without then with duplicates
+template <size_t... Index>
+constexpr array<EngineOps, sizeof...(Index)> engineTable(index_sequence<Index...>) {
+    return {{engineOps<Index / 2 + 1, Index % 2 == 1>()...}};
+}
+
+// The engine for a code length (1 to maxPegs) and duplicate setting
+inline const EngineOps& selectEngine(int length, char choiceDuplicate) {
+    static const array<EngineOps, 2 * maxPegs> engines = 
+        engineTable(make_index_sequence<2 * maxPegs>());
+    return engines[(length - 1) * 2 + (tolower(choiceDuplicate) == 'y')];
 }
 
 /************************************************************
-*    Prompts the user to select a code length for the game 
-*    and validates the input, ensuring it is 4, 6, or 8.
- ***********************************************************/
-int getCodeLength(){
-    int length;
+*    Hot-path instrumentation, built only when compiled with 
+*    -DMASTERMIND_METRICS. Each timed phase keeps a call 
+*    count, total time and a log2 histogram of latencies; 
+*    hash-table lookups record their probe lengths and every 
+*    heap allocation is counted, in total and per phase. 
+*    Without the flag the macros below expand to nothing, so 
+*    there is no cost at all.
+***********************************************************/
+#ifdef MASTERMIND_METRICS
+
+// Counting allocations needs the allocator hook below
+#ifndef MASTERMIND_ALLOC_CHECK
+#define MASTERMIND_ALLOC_CHECK
+#endif
+
+enum MetricPhase { PHASE_GEN_CODE, PHASE_HINT, PHASE_COMPARE_GUESS, 
+                   PHASE_HASH_INSERT, PHASE_HASH_SEARCH, PHASE_TREE_INSERT, 
+                   PHASE_DISPLAY_STATISTICS, PHASE_PRINT_SORTED_SCORES, 
+                   PHASE_PRINT_HASH_TABLE, PHASE_OUTPUT_FLUSH, NUM_PHASES };
+
+class Metrics {
+private:
+    static const int numBuckets = 40;   // Bucket i counts values in [2^(i-1), 2^i)
     
-    do {
-        try {
-            cout << "Choose the code length: " << endl;
-            cout << "4" << endl;
-            cout << "6" << endl;
-            cout << "8" << endl;
-            cin >> length;
-            if (cin.fail()){ 
-                throw invalid_argument("Invalid input type. Please enter a number.");
-            }
-            if (length != 4 && length != 6 && length != 8){ 
-                throw invalid_argument("Invalid code length. Please enter 4, 6, or 8.");
-            }
-        } 
-        catch (const invalid_argument& e) {
-            cout << "Error: " << e.what() << endl;
-            cin.clear();
-            cin.ignore(100, '\n');
-            length = 0;
+    struct Histogram {
+        atomic<uint64_t> count;
+        atomic<uint64_t> total;
+        atomic<uint64_t> max;
+        atomic<uint64_t> buckets[numBuckets];
+        
+        void add(uint64_t value) {
+            int bucket = value ? min(numBuckets - 1, 64 - __builtin_clzll(value)) : 0;
+            count.fetch_add(1, memory_order_relaxed);
+            total.fetch_add(value, memory_order_relaxed);
+            buckets[bucket].fetch_add(1, memory_order_relaxed);
+            uint64_t seen = max.load(memory_order_relaxed);
+            while (value > seen && 
+                   !max.compare_exchange_weak(seen, value, memory_order_relaxed)) {
+            }
+        }
+        
+        // Upper bound of the bucket holding the `p` quantile
+        uint64_t quantile(double p) const {
+            uint64_t target = static_cast<uint64_t>(p * count.load());
+            uint64_t seen = 0;
+            for (int i = 0; i < numBuckets; i++) {
+                seen += buckets[i].load();
+                if (seen > target) {
+                    return std::min<uint64_t>(max.load(), i ? (1ull << i) - 1 : 0);
+                }
+            }
+            return max.load();
+        }
+        
+        void writeJson(ostream& out, const char* unit) const {
+            uint64_t n = count.load();
+            out << "{\"count\": " << n << ", \"total_" << unit << "\": " << total.load() 
+                << ", \"mean_" << unit << "\": " 
+                << (n ? static_cast<double>(total.load()) / n : 0.0) 
+                << ", \"p50_" << unit << "\": " << quantile(0.50) 
+                << ", \"p99_" << unit << "\": " << quantile(0.99) 
+                << ", \"max_" << unit << "\": " << max.load() << ", \"log2_histogram\": [";
+            int last = numBuckets - 1;
+            while (last > 0 && buckets[last].load() == 0) {
+                last--;
+            }
+            for (int i = 0; i <= last; i++) {
+                out << (i ? ", " : "") << buckets[i].load();
+            }
+            out << "]}";
         }
-    } while (length != 4 && length != 6 && length != 8);
+    };
     
-    return length;    
-}
+    Histogram phases[NUM_PHASES];
+    atomic<uint64_t> phaseAllocations[NUM_PHASES];
+    Histogram probes;
 
-/************************************************************
-*    Prompts the user to decide if duplicates are allowed in 
-*    the game code, validating the input as either 'y' or 
-*    'n'.
- ***********************************************************/
-char getDuplicateChoice(){
-    char choiceDuplicate;
+public:
+    atomic<uint64_t> allocations;
+    atomic<uint64_t> allocatedBytes;
     
-    do {
-        try {
-            cout << "Do you want to play with duplicates? [y/n]: ";
-            cin >> choiceDuplicate;
-            if (cin.fail()){ 
-                throw invalid_argument("Invalid input type. Please enter 'y' or 'n'.");
-            }
-            choiceDuplicate = tolower(choiceDuplicate);
-            if (choiceDuplicate != 'y' && choiceDuplicate != 'n'){ 
-                throw invalid_argument("Invalid choice. Please enter 'y' or 'n'.");
-            }
-        } 
-        catch (const invalid_argument& e) {
-            cout << "Error: " << e.what() << endl;
-            cin.clear();
-            cin.ignore(100, '\n');
-            choiceDuplicate = '\0';
+    // One call of `phase` that took `ns` and made `allocated` allocations
+    void recordPhase(MetricPhase phase, uint64_t ns, uint64_t allocated) {
+        phases[phase].add(ns);
+        phaseAllocations[phase].fetch_add(allocated, memory_order_relaxed);
+    }
+    
+    void recordProbe(uint64_t length) {
+        probes.add(length);
+    }
+    
+    void writeJson(ostream& out) const {
+        static const char* const names[NUM_PHASES] = {
+            "genCode", "hint", "compareGuess", "HashTable::insert", 
+            "HashTable::search", "TreeNode::insert", "displayStatistics", 
+            "printSortedScores", "printHashTable", "Renderer::flush"
+        };
+        out << "{\n  \"phases\": {\n";
+        for (int i = 0; i < NUM_PHASES; i++) {
+            out << "    \"" << names[i] << "\": ";
+            phases[i].writeJson(out, "ns");
+            out << (i + 1 < NUM_PHASES ? ",\n" : "\n");
         }
-    } while (choiceDuplicate != 'y' && choiceDuplicate != 'n');
+        out << "  },\n  \"phase_allocations\": {";
+        for (int i = 0; i < NUM_PHASES; i++) {
+            out << (i ? ", " : "") << "\"" << names[i] << "\": " 
+                << phaseAllocations[i].load();
+        }
+        out << "},\n  \"hash_probe_length\": ";
+        probes.writeJson(out, "slots");
+        out << ",\n  \"allocations\": {\"count\": " << allocations.load() 
+            << ", \"bytes\": " << allocatedBytes.load() << "}\n}\n";
+    }
+};
+
+Metrics metrics;    // Zero-initialized before any allocation can happen
+
+extern thread_local uint64_t threadAllocations;
+
+// Times the enclosing scope as one call of `phase` and counts its allocations
+class PhaseTimer {
+private:
+    MetricPhase phase;
+    chrono::steady_clock::time_point start;
+    uint64_t startAllocations;
+
+public:
+    PhaseTimer(MetricPhase phase) {
+        this->phase = phase;
+        start = chrono::steady_clock::now();
+        startAllocations = threadAllocations;
+    }
     
-    return choiceDuplicate;
-}
+    ~PhaseTimer() {
+        metrics.recordPhase(phase, chrono::duration_cast<chrono::nanoseconds>(
+                                   chrono::steady_clock::now() - start).count(), 
+                            threadAllocations - startAllocations);
+    }
+};
 
-/************************************************************
-*    Displays the end-of-game message, reveals the correct 
-*    code, and displays a game over message.
- ***********************************************************/
-void showGameOverMessage(const list<char> &code){
-    cout << "\nThe code was: ";
-    printCode(code);
-    printGameOver(); 
+// Writes the metrics to $MASTERMIND_METRICS_FILE, or to stderr
+static void dumpMetricsAtExit() {
+    const char* path = getenv("MASTERMIND_METRICS_FILE");
+    if (path) {
+        ofstream file(path);
+        metrics.writeJson(file);
+    } else {
+        metrics.writeJson(cerr);
+    }
 }
 
-/************************************************************
-*    Ask the user if he or she wants to play again. If the
-*    the user responds 'y', the game will start over with a
-*    new secret code. If 'n', the program ends.
+#define METRIC_TIMER(phase) PhaseTimer phaseTimer(phase)
+#define METRIC_PROBE(length) metrics.recordProbe(length)
+
+#else
+
+#define METRIC_TIMER(phase)
+#define METRIC_PROBE(length)
+
+#endif
+
+/************************************************************
+*    The counting allocator hook, built only when compiled 
+*    with -DMASTERMIND_ALLOC_CHECK (metrics builds turn it on 
+*    too); otherwise the standard allocator is left alone. 
+*    Every heap allocation made through operator new (and so 
+*    by every standard container) adds one to the allocating 
+*    thread's count. The plain, nothrow and aligned forms are 
+*    all replaced; the array forms call them by default. 
+*    Metrics builds also keep process-wide totals. 
+*    AllocationCounter reads the count around a piece of code.
+***********************************************************/
+#ifdef MASTERMIND_ALLOC_CHECK
+
+thread_local uint64_t threadAllocations = 0;
+
+static inline void countAllocation(size_t size) {
+    threadAllocations++;
+#ifdef MASTERMIND_METRICS
+    metrics.allocations.fetch_add(1, memory_order_relaxed);
+    metrics.allocatedBytes.fetch_add(size, memory_order_relaxed);
+#else
+    (void)size;
+#endif
+}
+
+// Aligned storage for `size` bytes, or nullptr
+static inline void* alignedBlock(size_t size, align_val_t alignment) {
+    size_t align = static_cast<size_t>(alignment);
+    size = (size + align - 1) & ~(align - 1);   // aligned_alloc needs a multiple
+    return aligned_alloc(align, size ? size : align);
+}
+
+void* operator new(size_t size) {
+    countAllocation(size);
+    if (void* block = malloc(size ? size : 1)) {
+        return block;
+    }
+    throw bad_alloc();
+}
+
+void* operator new(size_t size, const nothrow_t&) noexcept {
+    countAllocation(size);
+    return malloc(size ? size : 1);
+}
+
+void* operator new(size_t size, align_val_t alignment) {
+    countAllocation(size);
+    if (void* block = alignedBlock(size, alignment)) {
+        return block;
+    }
+    throw bad_alloc();
+}
+
+void* operator new(size_t size, align_val_t alignment, const nothrow_t&) noexcept {
+    countAllocation(size);
+    return alignedBlock(size, alignment);
+}
+
+// GCC cannot see that the replacement new above pairs with free
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void* block) noexcept {
+    free(block);
+}
+
+void operator delete(void* block, size_t) noexcept {
+    free(block);
+}
+
+void operator delete(void* block, align_val_t) noexcept {
+    free(block);
+}
+
+void operator delete(void* block, size_t, align_val_t) noexcept {
+    free(block);
+}
+#pragma GCC diagnostic pop
+
+// Heap allocations the current thread has made since construction
+class AllocationCounter {
+private:
+    uint64_t start;
+
+public:
+    // Constructor
+    AllocationCounter() {
+        start = threadAllocations;
+    }
+    
+    uint64_t count() const {
+        return threadAllocations - start;
+    }
+};
+
+#endif
+
+// How much the game prints after each turn and game
+enum OutputLevel { QUIET, SUMMARY, FULL };
+
+/************************************************************
+*    Collects the game's status output in one reusable 
+*    buffer and writes it out in a single call per turn or 
+*    game, instead of flushing at every line. The output 
+*    level decides which reports are printed at all: QUIET 
+*    only shows the turns and the end of each game, SUMMARY 
+*    adds the statistics totals and scores, and FULL adds 
+*    the game history and hash table contents, at most 
+*    `maxRows` lines of each.
+***********************************************************/
+class Renderer {
+private:
+    // Stream buffer that appends to `text`
+    class Buffer : public streambuf {
+    public:
+        string text;
+    protected:
+        int_type overflow(int_type ch) override {
+            if (ch != traits_type::eof()) {
+                text.push_back(static_cast<char>(ch));
+            }
+            return ch;
+        }
+        streamsize xsputn(const char* chars, streamsize n) override {
+            text.append(chars, n);
+            return n;
+        }
+    };
+    
+    Buffer buffer;
+    ostream out;
+    OutputLevel level;
+    size_t maxRows;
+
+public:
+    // Constructor
+    Renderer() : out(&buffer) {
+        level = SUMMARY;
+        maxRows = 50;
+    }
+    
+    // Stream the output is built in
+    ostream& stream() {
+        return out;
+    }
+    
+    OutputLevel getLevel() const {
+        return level;
+    }
+    
+    void setLevel(OutputLevel level) {
+        this->level = level;
+    }
+    
+    // Most lines a FULL listing prints
+    size_t getMaxRows() const {
+        return maxRows;
+    }
+    
+    // Write everything collected so far to stdout and empty the buffer
+    void flush() {
+        METRIC_TIMER(PHASE_OUTPUT_FLUSH);
+        if (!buffer.text.empty()) {
+            cout.write(buffer.text.data(), buffer.text.size());
+            cout.flush();
+            buffer.text.clear();
+        }
+    }
+};
+
+Renderer renderer;              // Builds the game's status output
+
+
+/************************************************************
+*    Holds the result of a single game of Mastermind,
+*    including game settings, outcome and how long it took.
  ***********************************************************/
-void newGame(char &playAgain){
-    cout << "\nDo you want to play again? [y/n]: ";
-    cin >> playAgain;
-    playAgain = tolower(playAgain);
-    if (playAgain == 'n') {
-        cout << "Thanks for playing! Goodbye!" << endl;
+struct GameResult {
+    int codeLength;
+    int numColors;
+    char duplicateSetting;
+    bool isWin; // true if user won, false if lost
+    int turnsUsed;
+    uint32_t elapsedMs; // Time from the secret code to the last guess
+    GameResult(int len, int colors, char dup, bool win, int turns, 
+               uint32_t elapsed = 0)  {
+        codeLength = len; 
+        numColors = colors;
+        duplicateSetting = dup; 
+        isWin = win;
+        turnsUsed = turns;
+        elapsedMs = elapsed;
+    }
+};
+
+/************************************************************
+*    What a game leaves behind besides its outcome: when it 
+*    started and every guess played, in order. Front ends 
+*    keep one per game in progress, `begin` it with the game 
+*    and hand it to recordResult when the game is over.
+***********************************************************/
+struct GameTrace {
+    chrono::steady_clock::time_point start;
+    vector<Code> guesses;
+    
+    // Start a new game, keeping the guess buffer sized for the longest game
+    void begin() {
+        start = chrono::steady_clock::now();
+        guesses.clear();
+        guesses.reserve(turnLimit(maxPegs, maxColors));
+    }
+    
+    // Milliseconds since `begin`
+    uint32_t elapsedMs() const {
+        auto elapsed = chrono::duration_cast<chrono::milliseconds>(
+                       chrono::steady_clock::now() - start).count();
+        return static_cast<uint32_t>(min<int64_t>(elapsed, UINT32_MAX));
+    }
+};
+
+/************************************************************
+*    A struct representing a node in a balanced (AVL) binary 
+*    search tree, where each node stores a game result and 
+*    has pointers to its left and right children to store 
+*    and organize game results for efficient retrieval and 
+*    manipulation. Nodes are ordered by code length, then 
+*    number of colors, then duplicate setting, then the order 
+*    the games were played.
+***********************************************************/
+struct TreeNode {
+    GameResult result;
+    long order;     // Position of the game in the history
+    int height;     // Height of the subtree rooted here
+    TreeNode* left;
+    TreeNode* right;
+    TreeNode(GameResult gr, long order) : result(gr){
+        this->order = order;
+        this->height = 1;
+        this->left = nullptr;
+        this->right = nullptr;
+    }
+};
+
+/************************************************************
+*    A slab allocator for `TreeNode`s. Nodes are carved out
+*    of blocks of `blockNodes` contiguous nodes, so the tree
+*    of one session sits together in memory. Nodes are never
+*    freed one by one: `reset` drops all of them at once in
+*    O(1) and keeps the blocks for reuse, and the destructor
+*    releases the blocks.
+***********************************************************/
+class NodeArena {
+private:
+    static const size_t blockNodes = 1024;  // Nodes per block
+    vector<TreeNode*> blocks;   // Raw storage for blockNodes nodes each
+    size_t block;               // Block currently being filled
+    size_t next;                // Next free node in that block
+    size_t allocated;           // Nodes handed out since the last reset
+
+public:
+    // Constructor
+    NodeArena() {
+        block = 0;
+        next = 0;
+        allocated = 0;
+    }
+
+    // Destructor
+    ~NodeArena() {
+        for (TreeNode* storage : blocks) {
+            ::operator delete(storage);
+        }
+    }
+
+    NodeArena(const NodeArena&) = delete;
+    NodeArena& operator=(const NodeArena&) = delete;
+
+    // Construct a node in the next free slot
+    TreeNode* create(const GameResult& gr, long order) {
+        if (next == blockNodes) {
+            block++;
+            next = 0;
+        }
+        if (block == blocks.size()) {
+            blocks.push_back(static_cast<TreeNode*>(
+                ::operator new(blockNodes * sizeof(TreeNode))));
+        }
+        allocated++;
+        return new (blocks[block] + next++) TreeNode(gr, order);
+    }
+
+    // Make sure the next `count` nodes fit in blocks already held
+    void reserve(size_t count) {
+        size_t needed = (allocated + count + blockNodes - 1) / blockNodes;
+        while (blocks.size() < needed) {
+            blocks.push_back(static_cast<TreeNode*>(
+                ::operator new(blockNodes * sizeof(TreeNode))));
+        }
+    }
+
+    // Forget every node; TreeNode has a trivial destructor
+    void reset() {
+        block = 0;
+        next = 0;
+        allocated = 0;
+    }
+
+    // Bytes taken by the nodes handed out since the last reset
+    size_t bytesInUse() const {
+        return allocated * sizeof(TreeNode);
+    }
+
+    // Bytes held in blocks, used or not
+    size_t bytesReserved() const {
+        return blocks.size() * blockNodes * sizeof(TreeNode);
+    }
+};
+
+class HistoryLog;
+class IssuedCodes;
+class CandidateSet;
+
+/************************************************************
+*    Running totals for one board setting (code length, 
+*    number of colors and duplicate choice), updated in O(1) 
+*    per recorded game.
+***********************************************************/
+struct ConfigStats {
+    long wins;
+    long losses;
+    long turnsUsed;     // Turns used over all games
+};
+
+/************************************************************
+*    Board settings ranked by points (wins), kept in order as 
+*    games are recorded so the scores can be shown without 
+*    sorting. Each setting's place is kept alongside the 
+*    order, so a game finds its setting in constant time and 
+*    a win only moves it past the settings it now outscores; 
+*    a loss costs nothing more. Ties keep the settings in 
+*    `boardIndex` order. Labels are written straight to the 
+*    output rather than built per entry.
+***********************************************************/
+class Leaderboard {
+private:
+    static const int numConfigs = numBoards;
+    int order[numConfigs];      // Played settings, best first
+    int rank[numConfigs];       // Place of each played setting in `order`
+    long points[numConfigs];    // Wins of each setting
+    bool played[numConfigs];    // Whether a setting has any games
+    int entries;                // Number of played settings
+    
+    // Whether setting `a` ranks above setting `b`
+    bool ranksAbove(int a, int b) const {
+        return points[a] > points[b] || (points[a] == points[b] && a < b);
+    }
+
+public:
+    // Constructor
+    Leaderboard() {
+        clear();
+    }
+    
+    void clear() {
+        entries = 0;
+        for (int i = 0; i < numConfigs; i++) {
+            points[i] = 0;
+            played[i] = false;
+        }
+    }
+    
+    // Count a finished game for setting `config` (see boardIndex)
+    void addGame(int config, bool isWin) {
+        int pos;
+        if (!played[config]) {
+            played[config] = true;
+            pos = entries++;
+        } else {
+            pos = rank[config];
+        }
+        if (isWin) {
+            points[config]++;
+        }
+        while (pos > 0 && ranksAbove(config, order[pos - 1])) {
+            order[pos] = order[pos - 1];
+            rank[order[pos]] = pos;
+            pos--;
+        }
+        order[pos] = config;
+        rank[config] = pos;
+    }
+    
+    // Number of settings on the board
+    int size() const {
+        return entries;
+    }
+    
+    // Setting at `rank` (0 is the best)
+    int at(int rank) const {
+        return order[rank];
+    }
+    
+    // Points of a setting
+    long getPoints(int config) const {
+        return points[config];
+    }
+    
+    // Write the display name of a setting
+    static void writeLabel(ostream& out, int config) {
+        int board = config / 2;
+        out << "Length: " << board / maxColors + 1 
+            << ", Colors: " << board % maxColors + 1 
+            << ((config & 1) ? ", Duplicates" : ", No duplicates");
+    }
+};
+
+/************************************************************
+*    Every recorded game stored column by column and split by 
+*    board setting (see boardIndex): one array per field (won, 
+*    turns used, time taken) and the guesses of all games back 
+*    to back, with the end of each game's guesses in 
+*    `guessEnd`. A query reads only the columns it needs, in 
+*    blocks that stay in the L1 cache, with plain loops over 
+*    small integers that the compiler turns into SIMD code, so 
+*    tens of millions of games are aggregated in milliseconds.
+***********************************************************/
+class GameHistory {
+public:
+    // Totals over the games of one board setting
+    struct Summary {
+        long games;
+        long wins;
+        long turnsUsed;
+    };
+
+private:
+    static constexpr size_t blockGames = 4096;  // Games counted per block
+    
+    struct Columns {
+        vector<uint8_t> won;            // 1 for a win, 0 for a loss
+        vector<uint8_t> turns;          // Turns used
+        vector<uint32_t> elapsedMs;     // Time taken
+        vector<uint64_t> guessEnd;      // End of each game's guesses
+        vector<uint64_t> guesses;       // Code bits of every guess
+        int maxTurns;                   // Most turns any game used
+    };
+    Columns boards[numBoards];
+    long count;
+    
+    // The scans over one block. Called with n == blockGames for every 
+    // full block, so the loop count is a constant and -O2 vectorizes 
+    // the loops.
+    static inline void sumBlock(const uint8_t* won, const uint8_t* turns, 
+                                size_t n, uint32_t& wins, uint32_t& turnsUsed) {
+        wins = 0;
+        turnsUsed = 0;
+        for (size_t i = 0; i < n; i++) {
+            wins += won[i];
+            turnsUsed += turns[i];
+        }
+    }
+    
+    // Games won in `t` turns, or lost if `t` is 0
+    static inline uint32_t countBlock(const uint8_t* won, const uint8_t* turns, 
+                                      size_t n, int t) {
+        uint8_t target = static_cast<uint8_t>(t);
+        uint32_t matches = 0;
+        for (size_t i = 0; i < n; i++) {
+            uint8_t key = turns[i] & -won[i];   // A lost game counts as 0 turns
+            matches += key == target;
+        }
+        return matches;
+    }
+
+public:
+    // Constructor
+    GameHistory() {
+        clear();
+    }
+    
+    void clear() {
+        for (Columns& column : boards) {
+            column.won.clear();
+            column.turns.clear();
+            column.elapsedMs.clear();
+            column.guessEnd.clear();
+            column.guesses.clear();
+            column.maxTurns = 0;
+        }
+        count = 0;
+    }
+    
+    // Add a game of setting `board`; `guesses` holds `numGuesses` codes
+    void append(int board, bool isWin, int turnsUsed, uint32_t elapsedMs, 
+                const Code* guesses, int numGuesses) {
+        Columns& column = boards[board];
+        column.won.push_back(isWin);
+        column.turns.push_back(static_cast<uint8_t>(turnsUsed));
+        column.elapsedMs.push_back(elapsedMs);
+        for (int i = 0; i < numGuesses; i++) {
+            column.guesses.push_back(guesses[i].bits);
+        }
+        column.guessEnd.push_back(column.guesses.size());
+        column.maxTurns = max(column.maxTurns, turnsUsed);
+        count++;
+    }
+    
+    // Make room for `games` more games of setting `board` with up 
+    // to `maxGuesses` guesses each, doubling a column that is short
+    void reserve(int board, size_t games, int maxGuesses) {
+        Columns& column = boards[board];
+        size_t size = column.won.size();
+        if (column.won.capacity() < size + games) {
+            size_t capacity = max(2 * column.won.capacity(), size + games);
+            column.won.reserve(capacity);
+            column.turns.reserve(capacity);
+            column.elapsedMs.reserve(capacity);
+            column.guessEnd.reserve(capacity);
+        }
+        size_t guesses = column.guesses.size() + games * maxGuesses;
+        if (column.guesses.capacity() < guesses) {
+            column.guesses.reserve(max(2 * column.guesses.capacity(), guesses));
+        }
+    }
+    
+    // Number of games recorded
+    long size() const {
+        return count;
+    }
+    
+    // Number of games of setting `board`
+    long games(int board) const {
+        return static_cast<long>(boards[board].won.size());
+    }
+    
+    // Most turns any game of setting `board` used
+    int maxTurns(int board) const {
+        return boards[board].maxTurns;
+    }
+    
+    // Bytes taken by the columns
+    size_t bytesInUse() const {
+        size_t bytes = 0;
+        for (const Columns& column : boards) {
+            bytes += column.won.size() * (2 + sizeof(uint32_t) + sizeof(uint64_t)) + 
+                     column.guesses.size() * sizeof(uint64_t);
+        }
+        return bytes;
+    }
+    
+    Summary summarize(int board) const;
+    void turnHistogram(int board, long* counts) const;
+    void elapsedPercentiles(int board, const double* fractions, int n, 
+                            uint32_t* times) const;
+    Code openingGuess(int board, long& games) const;
+};
+
+/************************************************************
+*    The results of every game played in the session. Keeps 
+*    O(1) totals per board setting for the statistics screens, 
+*    the per-game history in a balanced tree, so inserts and 
+*    traversals stay O(log n) deep however long the session 
+*    runs, and the details of each game (time taken, guesses) 
+*    in a GameHistory for aggregate queries. The tree's nodes 
+*    come from an arena, so clearing the history is O(1) and 
+*    nothing leaks.
+***********************************************************/
+class ResultsIndex {
+private:
+    NodeArena arena;            // Storage for the history tree
+    TreeNode* root;             // Per-game history
+    long count;                 // Games recorded
+    ConfigStats stats[numBoards];   // Totals per board setting (see boardIndex)
+    Leaderboard leaderboard;    // Settings ranked by wins
+    HistoryLog* log;            // Where new games are saved, if anywhere
+    GameHistory history;        // Per-game details, column by column
+
+public:
+    // Constructor
+    ResultsIndex() {
+        log = nullptr;
+        clear();
+    }
+    
+    // Drop every recorded game, keeping the arena's blocks for reuse
+    void clear() {
+        arena.reset();
+        history.clear();
+        leaderboard.clear();
+        root = nullptr;
+        count = 0;
+        for (ConfigStats& config : stats) {
+            config.wins = 0;
+            config.losses = 0;
+            config.turnsUsed = 0;
+        }
+    }
+    
+    // Totals for a board setting
+    const ConfigStats& getStats(int codeLength, int numColors, 
+                                char duplicateSetting) const {
+        return stats[boardIndex(codeLength, numColors, duplicateSetting)];
+    }
+    
+    // Totals for the setting with index `config` (see boardIndex)
+    const ConfigStats& getStats(int config) const {
+        return stats[config];
+    }
+    
+    // Settings ranked by wins
+    const Leaderboard& getLeaderboard() const {
+        return leaderboard;
+    }
+    
+    // Root of the per-game history tree
+    TreeNode* getRoot() const {
+        return root;
+    }
+    
+    // Number of games recorded
+    long size() const {
+        return count;
+    }
+    
+    // Save every game recorded from now on to `historyLog`
+    void setLog(HistoryLog* historyLog) {
+        log = historyLog;
+    }
+    
+    // Arena holding the history tree, for memory accounting
+    const NodeArena& getArena() const {
+        return arena;
+    }
+    
+    // Columnar game details, for aggregate queries
+    const GameHistory& getHistory() const {
+        return history;
+    }
+    
+    // Games of a setting that can be started before the storage for 
+    // recording them has to grow again
+    static const int spareGames = 64;
+    
+    /********************************************************
+    *    Makes room for the results of the next `spareGames` 
+    *    games of a setting, so recording a game started 
+    *    after this allocates nothing. Called when a game 
+    *    starts; a game recorded without it still fits, but 
+    *    may grow the storage then.
+    ********************************************************/
+    void reserve(int codeLength, int numColors, char duplicateSetting) {
+        arena.reserve(spareGames);
+        history.reserve(boardIndex(codeLength, numColors, duplicateSetting), 
+                        spareGames, turnLimit(codeLength, numColors));
+    }
+    
+    void insert(const GameResult& gr, const Code* guesses = nullptr);
+};
+
+/************************************************************
+*    Everything one game needs, in 24 bytes: the secret 
+*    code, the settings and the engine compiled for them, the 
+*    turn limit, the turns used and whether the game is still 
+*    on. `submit` plays a turn and returns its feedback 
+*    without any I/O, so any front end (console, batch runs, 
+*    the server) can drive a game, and many games can be kept 
+*    in memory at once.
+***********************************************************/
+class GameSession {
+private:
+    const EngineOps* engine;    // Scoring for this game's settings
+    Code code;                  // Secret code
+    uint8_t length;             // Number of pegs, 0 before the first game
+    uint8_t colors;             // Number of colors
+    char choiceDuplicate;       // 'y' or 'n'
+    uint8_t turnLimit;          // Guesses allowed
+    uint8_t turnsUsed;          // Guesses scored so far
+    uint8_t state;              // One of the states below
+
+public:
+    enum { IDLE, PLAYING, WON, LOST };
+    
+    // Constructor
+    GameSession() {
+        engine = nullptr;
+        length = 0;
+        colors = 0;
+        choiceDuplicate = 'n';
+        turnLimit = 0;
+        turnsUsed = 0;
+        state = IDLE;
+    }
+    
+    bool start(int length, int colors, char choiceDuplicate, 
+               CodeGenerator& generator = codeGenerator, 
+               IssuedCodes* issued = nullptr);
+    Feedback submit(const Code& guess);
+    
+    const Code& getCode() const {
+        return code;
+    }
+    
+    // Hint text for a feedback in this game, e.g. "OX__"
+    const char* hintText(const Feedback& fb) const {
+        return engine->hint(fb);
+    }
+    
+    int getLength() const {
+        return length;
+    }
+    
+    int getColors() const {
+        return colors;
+    }
+    
+    char getDuplicateChoice() const {
+        return choiceDuplicate;
+    }
+    
+    int getTurnsUsed() const {
+        return turnsUsed;
+    }
+    
+    int getTurnLimit() const {
+        return turnLimit;
+    }
+    
+    int getTurnsLeft() const {
+        return turnLimit - turnsUsed;
+    }
+    
+    // Whether a game is in progress
+    bool isPlaying() const {
+        return state == PLAYING;
+    }
+    
+    // Whether the last game has been won or lost
+    bool isOver() const {
+        return state == WON || state == LOST;
+    }
+    
+    bool isWon() const {
+        return state == WON;
+    }
+};
+
+// What is wrong with a typed guess, if anything
+enum InputError { INPUT_OK, INPUT_EMPTY, INPUT_BAD_CHARACTERS, 
+                  INPUT_WRONG_LENGTH, INPUT_BAD_SYMBOLS };
+
+//Function prototypes
+void setupGame(unsigned int);
+char getDuplicateChoice();
+int getCodeLength();
+int getColorCount();
+bool genCode(int, int, Code&, char, CodeGenerator& = codeGenerator, 
+             IssuedCodes* = nullptr);
+void printCode(const Code&);
+void hint(const Code&, const Code&, bool);
+uint64_t colorCounts(const Code&);
+Feedback scoreGuess(const Code&, const Code&);
+void scoreBatch(const Code&, const Code*, size_t, Feedback*);
+void showGameOverMessage(const Code&);
+void showInstructions();
+char getSolverChoice();
+int getSolverStrategy();
+InputError checkGuess(string_view, int, int);
+void appendInputError(string&, InputError, int);
+void validInput(const string&, bool&, const int&, int, ostream& = cout);
+void compareGuess(GameSession&, const string&, ResultsIndex&, bool, 
+                  CandidateSet* = nullptr, GameTrace* = nullptr);
+void exitingGame(bool&);
+void newGame(char&);
+void recordResult(int, int, char, bool, int, ResultsIndex&, 
+                  const GameTrace* = nullptr);
+void displayStatistics(const ResultsIndex&);
+void printWelcome();
+void printGameOver();
+void insert(TreeNode*&, const GameResult&, long, NodeArena&);
+void printInOrder(TreeNode*);
+void extractScores(TreeNode*, vector<pair<string, int>>&);
+void printLeaderboard(const Leaderboard&, int, int);
+void printSortedScores(const ResultsIndex&);
+void printHistoryReport(const GameHistory&, ostream&);
+unsigned int RSHash(const Code&);
+void enumerateCodes(int, int, char, vector<Code>&);
+int runBatch(int, char*[]);
+int runReplay(int, char*[]);
+int runBuildBook(int, char*[]);
+int runEvaluate(int, char*[]);
+int runBench(int, char*[]);
+int runReport(int, char*[]);
+int runServer(int, char*[]);
+#ifdef MASTERMIND_ALLOC_CHECK
+int runAllocCheck(int, char*[]);
+#endif
+
+/************************************************************
+*    Probe and load statistics reported by `HashTable`.
+***********************************************************/
+struct HashTableStats {
+    size_t entries;      // Distinct keys stored
+    size_t capacity;     // Number of slots
+    double loadFactor;   // entries / capacity
+    double avgProbe;     // Mean distance of a key from its home slot
+    int maxProbe;        // Longest distance of a key from its home slot
+};
+
+/************************************************************
+*    An open-addressing Hash Table using Robin Hood probing, 
+*    designed to handle keys represented as packed `Code` 
+*    objects together with the board setting they were drawn 
+*    for (see boardIndex), so equal pegs from different 
+*    boards are different keys. Keys, their settings, their 
+*    cached hashes, their insert counts and a control byte 
+*    per slot (probe distance + 1, 0 when empty) live in flat 
+*    arrays. The table doubles when it becomes 7/8 full.
+***********************************************************/
+class HashTable {
+private:
+    vector<Code> keys;          // Key stored in each slot
+    vector<uint16_t> configs;   // Board setting of each key
+    vector<uint32_t> hashes;    // Cached hash of each key
+    vector<uint32_t> counts;    // Times each key was inserted
+    vector<uint8_t> control;    // Probe distance + 1, or 0 for an empty slot
+    size_t mask;                // Number of slots - 1
+    int shift;                  // 32 - log2(number of slots)
+    size_t used;                // Number of occupied slots
+
+    // RSHash of the code, continued over its board setting
+    static uint32_t keyHash(const Code& key, int config) {
+        return RSHash(key) * 378551u + static_cast<uint32_t>(config);
+    }
+    
+    // Home slot of a hash; Fibonacci hashing spreads the low bits
+    size_t homeSlot(uint32_t hash) const {
+        return (hash * 2654435769u) >> shift;
+    }
+    
+    void allocate(size_t capacity) {
+        keys.assign(capacity, Code());
+        configs.assign(capacity, 0);
+        hashes.assign(capacity, 0);
+        counts.assign(capacity, 0);
+        control.assign(capacity, 0);
+        mask = capacity - 1;
+        shift = 32;
+        while (capacity > 1) {
+            capacity >>= 1;
+            shift--;
+        }
+        used = 0;
+    }
+    
+    // Slot holding `key`, or the number of slots if it is absent
+    size_t findSlot(const Code& key, int config, uint32_t hash) const {
+        size_t pos = homeSlot(hash);
+        uint8_t dist = 1;
+        for (; control[pos] >= dist; dist++) {
+            if (hashes[pos] == hash && keys[pos] == key && configs[pos] == config) {
+                METRIC_PROBE(dist);     // Slots examined
+                return pos;
+            }
+            pos = (pos + 1) & mask;
+        }
+        METRIC_PROBE(dist);
+        return mask + 1;
+    }
+    
+    // Robin Hood insertion: a key takes the slot of any richer key
+    void place(Code key, uint16_t config, uint32_t hash, uint32_t count) {
+        size_t pos = homeSlot(hash);
+        uint8_t dist = 1;
+        while (control[pos] != 0) {
+            if (control[pos] < dist) {
+                swap(key, keys[pos]);
+                swap(config, configs[pos]);
+                swap(hash, hashes[pos]);
+                swap(count, counts[pos]);
+                swap(dist, control[pos]);
+            }
+            pos = (pos + 1) & mask;
+            if (++dist == 255) { // Distance no longer fits the control byte
+                grow();
+                place(key, config, hash, count);
+                return;
+            }
+        }
+        keys[pos] = key;
+        configs[pos] = config;
+        hashes[pos] = hash;
+        counts[pos] = count;
+        control[pos] = dist;
+        used++;
+    }
+    
+    // Double the slots and reinsert every key using its cached hash
+    void grow() {
+        vector<Code> oldKeys;
+        vector<uint16_t> oldConfigs;
+        vector<uint32_t> oldHashes;
+        vector<uint32_t> oldCounts;
+        vector<uint8_t> oldControl;
+        oldKeys.swap(keys);
+        oldConfigs.swap(configs);
+        oldHashes.swap(hashes);
+        oldCounts.swap(counts);
+        oldControl.swap(control);
+        
+        allocate(oldKeys.size() * 2);
+        for (size_t i = 0; i < oldKeys.size(); i++) {
+            if (oldControl[i] != 0) {
+                place(oldKeys[i], oldConfigs[i], oldHashes[i], oldCounts[i]);
+            }
+        }
+    }
+
+public:
+    // Constructor: the capacity is rounded up to a power of two
+    HashTable(int tableSize) {
+        size_t capacity = 8;
+        while (capacity < static_cast<size_t>(tableSize)) {
+            capacity <<= 1;
+        }
+        allocate(capacity);
+    }
+    
+    // Number of slots in the hash table
+    size_t getCapacity() const {
+        return mask + 1;
+    }
+    
+    // Number of distinct keys in the hash table
+    size_t getEntries() const {
+        return used;
+    }
+    
+    // Whether slot `index` holds a key
+    bool isOccupied(size_t index) const {
+        return control[index] != 0;
+    }
+    
+    // Key stored in slot `index`
+    const Code& getKey(size_t index) const {
+        return keys[index];
+    }
+    
+    // Board setting of the key in slot `index`
+    int getConfig(size_t index) const {
+        return configs[index];
+    }
+    
+    // Times the key in slot `index` was inserted
+    uint32_t getCount(size_t index) const {
+        return counts[index];
+    }
+    
+    // Insert a key drawn for board setting `config`; repeated keys are counted
+    void insert(const Code& key, int config) {
+        METRIC_TIMER(PHASE_HASH_INSERT);
+        uint32_t hash = keyHash(key, config);
+        size_t pos = findSlot(key, config, hash);
+        if (pos <= mask) {
+            counts[pos]++;
+            return;
+        }
+        if ((used + 1) * 8 > getCapacity() * 7) {
+            grow();
+        }
+        place(key, static_cast<uint16_t>(config), hash, 1);
+    }
+    
+    // Search for a key of board setting `config` in the hash table
+    bool search(const Code& key, int config) const {
+        METRIC_TIMER(PHASE_HASH_SEARCH);
+        return findSlot(key, config, keyHash(key, config)) <= mask;
+    }
+    
+    // Remove a key, shifting the following cluster back one slot
+    bool erase(const Code& key, int config) {
+        size_t pos = findSlot(key, config, keyHash(key, config));
+        if (pos > mask) {
+            return false;
+        }
+        size_t next = (pos + 1) & mask;
+        while (control[next] > 1) {
+            keys[pos] = keys[next];
+            configs[pos] = configs[next];
+            hashes[pos] = hashes[next];
+            counts[pos] = counts[next];
+            control[pos] = control[next] - 1;
+            pos = next;
+            next = (next + 1) & mask;
+        }
+        control[pos] = 0;
+        used--;
+        return true;
+    }
+    
+    // Load and probe-length statistics
+    HashTableStats getStats() const {
+        HashTableStats stats;
+        size_t totalProbe = 0;
+        stats.entries = used;
+        stats.capacity = getCapacity();
+        stats.loadFactor = static_cast<double>(used) / stats.capacity;
+        stats.maxProbe = 0;
+        for (uint8_t dist : control) {
+            if (dist != 0) {
+                totalProbe += dist - 1;
+                stats.maxProbe = max(stats.maxProbe, dist - 1);
+            }
+        }
+        stats.avgProbe = used ? static_cast<double>(totalProbe) / used : 0.0;
+        return stats;
+    }
+};
+
+void printHashTable(const HashTable&);
+
+// Position of `code` among all codes of its length and `colors`: its 
+// pegs read as a number in base `colors`, the first peg lowest
+inline uint64_t codeRank(const Code& code, int colors) {
+    uint64_t index = 0;
+    for (int i = code.size() - 1; i >= 0; i--) {
+        index = index * colors + code.peg(i);
+    }
+    return index;
+}
+
+// The code at position `index`; the inverse of `codeRank`
+inline Code codeAtRank(uint64_t index, int length, int colors) {
+    Code code;
+    for (int i = 0; i < length; i++) {
+        code.bits |= (index % colors) << (4 * i);
+        index /= colors;
+    }
+    code.bits |= static_cast<uint64_t>(length) << 60;
+    return code;
+}
+
+/************************************************************
+*    Which secret codes have already been issued, as one bit 
+*    per possible code of each board setting. A code's bit is 
+*    its rank among the board's codes (its pegs read as a 
+*    number in base `colors`), so checking or marking a code 
+*    is a single bit operation. Bitmaps are kept for boards 
+*    of up to 2^24 codes (2 MB, e.g. 8 pegs of 8 colors); the 
+*    issued codes of larger boards go in a hash table, where 
+*    random draws almost never repeat anyway. For settings 
+*    without duplicates the codes with repeated colors are 
+*    marked from the start, so the clear bits are exactly the 
+*    codes still available. A count of clear bits per block 
+*    of 4096 codes lets `drawUnused` pick a random free code 
+*    by rank even when almost every code is taken.
+***********************************************************/
+class IssuedCodes {
+private:
+    static const int blockWords = 64;               // 4096 codes per summary block
+    static constexpr uint64_t maxBitmapCodes = 1u << 24;
+    
+    struct Space {
+        int config;                     // See boardIndex; -1 until built
+        vector<uint64_t> words;         // Bit set = issued (or never valid)
+        vector<uint32_t> blockFree;     // Clear bits in each block
+        uint64_t free;                  // Codes not issued yet
+        HashTable drawn;                // Issued codes when there is no bitmap
+        
+        Space() : drawn(8) {
+            config = -1;
+            free = 0;
+        }
+    };
+    
+    map<int, Space> spaces;     // By boardIndex
+    
+    // The bitmap or table for a setting, built on first use
+    Space& space(int length, int colors, char choiceDuplicate) {
+        int config = boardIndex(length, colors, choiceDuplicate);
+        Space& sp = spaces[config];
+        if (sp.config >= 0) {
+            return sp;
+        }
+        
+        sp.config = config;
+        sp.free = codeSpace(length, colors, choiceDuplicate);
+        uint64_t numCodes = codeSpace(length, colors, 'y');
+        if (numCodes > maxBitmapCodes) {
+            return sp;
+        }
+        
+        size_t numWords = (numCodes + 63) / 64;
+        bool allowDuplicates = tolower(choiceDuplicate) == 'y';
+        sp.words.assign(numWords, allowDuplicates ? 0 : ~0ull);
+        if (numCodes % 64 != 0) {
+            sp.words.back() |= ~0ull << (numCodes % 64);    // Past the last code
+        }
+        if (!allowDuplicates) {
+            vector<Code> valid;
+            enumerateCodes(length, colors, choiceDuplicate, valid);
+            for (const Code& code : valid) {
+                uint64_t index = codeRank(code, colors);
+                sp.words[index / 64] &= ~(1ull << (index % 64));
+            }
+        }
+        
+        sp.blockFree.assign((numWords + blockWords - 1) / blockWords, 0);
+        for (size_t w = 0; w < numWords; w++) {
+            sp.blockFree[w / blockWords] += 64 - __builtin_popcountll(sp.words[w]);
+        }
+        return sp;
+    }
+    
+    static void mark(Space& sp, uint64_t index) {
+        uint64_t bit = 1ull << (index % 64);
+        if (!(sp.words[index / 64] & bit)) {
+            sp.words[index / 64] |= bit;
+            sp.blockFree[index / 64 / blockWords]--;
+            sp.free--;
+        }
+    }
+
+public:
+    // Whether `code` has been issued for this setting
+    bool contains(const Code& code, int colors, char choiceDuplicate) {
+        Space& sp = space(code.size(), colors, choiceDuplicate);
+        if (sp.words.empty()) {
+            return sp.drawn.search(code, sp.config);
+        }
+        uint64_t index = codeRank(code, colors);
+        return (sp.words[index / 64] >> (index % 64)) & 1;
+    }
+    
+    // Record that `code` was issued for this setting
+    void markIssued(const Code& code, int colors, char choiceDuplicate) {
+        Space& sp = space(code.size(), colors, choiceDuplicate);
+        if (sp.words.empty()) {
+            if (!sp.drawn.search(code, sp.config)) {
+                sp.drawn.insert(code, sp.config);
+                sp.free--;
+            }
+            return;
+        }
+        mark(sp, codeRank(code, colors));
+    }
+    
+    // Codes of this setting not issued yet
+    uint64_t remaining(int length, int colors, char choiceDuplicate) {
+        return space(length, colors, choiceDuplicate).free;
+    }
+    
+    // Make every code of this setting available again
+    void reset(int length, int colors, char choiceDuplicate) {
+        spaces.erase(boardIndex(length, colors, choiceDuplicate));
+    }
+    
+    /********************************************************
+    *    Draws a code that has not been issued yet, marks it 
+    *    and stores it in `code`. A few plain random draws 
+    *    are tried first; if they keep hitting issued codes, 
+    *    the code is picked by a random rank among the free 
+    *    ones using the block counts. Returns false when 
+    *    every code has been issued.
+    ********************************************************/
+    bool drawUnused(int length, int colors, char choiceDuplicate, 
+                    CodeGenerator& generator, Code& code) {
+        Space& sp = space(length, colors, choiceDuplicate);
+        if (sp.free == 0) {
+            return false;
+        }
+        
+        const EngineOps& engine = selectEngine(length, choiceDuplicate);
+        if (sp.words.empty()) {
+            do {
+                code = engine.generate(generator, colors);
+            } while (sp.drawn.search(code, sp.config));
+            sp.drawn.insert(code, sp.config);
+            sp.free--;
+            return true;
+        }
+        
+        for (int attempt = 0; attempt < 4; attempt++) {
+            code = engine.generate(generator, colors);
+            uint64_t index = codeRank(code, colors);
+            if (!((sp.words[index / 64] >> (index % 64)) & 1)) {
+                mark(sp, index);
+                return true;
+            }
+        }
+        
+        // Select the free code of rank `target`
+        uint32_t target = generator.below(static_cast<uint32_t>(sp.free));
+        size_t block = 0;
+        while (target >= sp.blockFree[block]) {
+            target -= sp.blockFree[block++];
+        }
+        size_t w = block * blockWords;
+        while (true) {
+            uint32_t clear = 64 - __builtin_popcountll(sp.words[w]);
+            if (target < clear) {
+                break;
+            }
+            target -= clear;
+            w++;
+        }
+        uint64_t freeBits = ~sp.words[w];
+        for (uint32_t i = 0; i < target; i++) {
+            freeBits &= freeBits - 1;   // Drop the lowest free bit
+        }
+        uint64_t index = w * 64 + __builtin_ctzll(freeBits);
+        mark(sp, index);
+        code = codeAtRank(index, length, colors);
+        return true;
+    }
+};
+
+/************************************************************
+*    The codes still consistent with every hint of a game, 
+*    as one bit per code of the board in `codeRank` order, 
+*    so 8 pegs of 8 colors take 2 MB. After each guess the 
+*    set is narrowed 64 codes at a time, each word replaced 
+*    by the mask of its codes that would have given the same 
+*    hint. A code's rank splits into its first few pegs and 
+*    the rest; the blacks and color counts of every choice 
+*    of the first pegs are tabulated once per guess, and 
+*    those of the other pegs only change every few thousand 
+*    ranks, so scoring a code takes two table lookups and 
+*    one `commonColors`. Empty words are skipped with a 
+*    single compare, and while many codes remain the words 
+*    are split across a team of threads. The team is started 
+*    by the first update that needs it and then waits for the 
+*    next one, so once the buffers have grown to the board an 
+*    update allocates nothing. Boards of more than 
+*    `maxCodes` possible codes are not tracked.
+***********************************************************/
+class CandidateSet {
+private:
+    static const uint64_t maxLowCodes = 4096;   // Largest table of first pegs
+    
+    vector<uint64_t> words;     // Bit set = code of that rank still possible
+    uint64_t count;             // Set bits
+    int length;                 // Number of pegs, 0 when not tracking
+    int colors;                 // Number of colors
+    int numThreads;             // Worker threads for large updates
+    vector<uint8_t> lowBlack;   // Per choice of the first pegs: blacks,
+    vector<uint64_t> lowCounts; // and color counts against the guess
+    vector<uint64_t> kept;      // Codes each worker kept
+    vector<uint64_t> distinctWords; // The starting set without duplicates,
+    int distinctLength;             // for this board
+    int distinctColors;
+    uint64_t distinctCount;
+    
+    // The team: workers 1 to numThreads - 1 (the caller is worker 0)
+    vector<thread> team;
+    mutex teamLock;
+    condition_variable wake;    // A round has started, or the team is stopping
+    condition_variable finished;    // The last worker is done with a round
+    uint64_t round;             // Rounds started so far
+    int busy;                   // Workers still on the current round
+    bool stopping;
+    void (*job)(void*, int);    // The work of the current round
+    void* jobContext;
+    
+    void runTeam(int id);
+    void runRound(void (*work)(void*, int), void* context);
+
+public:
+    static constexpr uint64_t maxCodes = 1u << 24;  // 8 pegs of 8 colors
+    
+    // Constructor
+    CandidateSet() {
+        count = 0;
+        length = 0;
+        colors = 0;
+        distinctLength = 0;
+        distinctColors = 0;
+        distinctCount = 0;
+        round = 0;
+        busy = 0;
+        stopping = false;
+        job = nullptr;
+        jobContext = nullptr;
+        setThreads(static_cast<int>(max(1u, thread::hardware_concurrency())));
+    }
+    
+    // Destructor
+    ~CandidateSet() {
+        {
+            lock_guard<mutex> guard(teamLock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (thread& worker : team) {
+            worker.join();
+        }
+    }
+    
+    CandidateSet(const CandidateSet&) = delete;
+    CandidateSet& operator=(const CandidateSet&) = delete;
+    
+    // Split large updates across `threads` threads; call before the first update
+    void setThreads(int threads) {
+        numThreads = max(1, threads);
+        kept.assign(numThreads, 0);
+    }
+    
+    // Whether the codes of a board are few enough to track
+    static bool canTrack(int length, int colors) {
+        return codeSpace(length, colors, 'y') <= maxCodes;
+    }
+    
+    bool reset(int length, int colors, char choiceDuplicate);
+    void update(const Code& guess, const Feedback& fb);
+    
+    // Whether the set holds a board's codes
+    bool isTracking() const {
+        return length > 0;
+    }
+    
+    // Number of codes still consistent with the hints
+    uint64_t remaining() const {
+        return count;
+    }
+    
+    // Whether `code` is still consistent with the hints
+    bool contains(const Code& code) const {
+        uint64_t index = codeRank(code, colors);
+        return (words[index / 64] >> (index % 64)) & 1;
+    }
+    
+    // Visits the remaining codes in rank order
+    class Iterator {
+    private:
+        const CandidateSet* set;
+        uint64_t index;     // Rank of the current code, or the end
+        
+        void skipToSet() {
+            size_t w = index / 64;
+            uint64_t bits = (w < set->words.size()) ? 
+                            set->words[w] & (~0ull << (index % 64)) : 0;
+            while (bits == 0 && ++w < set->words.size()) {
+                bits = set->words[w];
+            }
+            index = (bits != 0) ? w * 64 + __builtin_ctzll(bits) : 
+                                  set->words.size() * 64;
+        }
+        
+    public:
+        Iterator(const CandidateSet* set, uint64_t index) {
+            this->set = set;
+            this->index = index;
+            skipToSet();
+        }
+        
+        Code operator*() const {
+            return codeAtRank(index, set->length, set->colors);
+        }
+        
+        Iterator& operator++() {
+            index++;
+            skipToSet();
+            return *this;
+        }
+        
+        bool operator!=(const Iterator& other) const {
+            return index != other.index;
+        }
+    };
+    
+    Iterator begin() const {
+        return Iterator(this, 0);
+    }
+    
+    Iterator end() const {
+        return Iterator(this, words.size() * 64);
+    }
+};
+
+/************************************************************
+*    On-disk layout of the game-history log: a header
+*    followed by fixed-size records. A 'C' record is a
+*    generated secret code (`value` holds its bits); a 'G'
+*    record is a guess of the game whose 'R' record follows 
+*    (`value` holds its bits); an 'R' record is a finished 
+*    game (`value` holds the turns used in its low 8 bits and 
+*    the milliseconds taken in the 32 bits above them).
+*    Version 2 logs have no 'G' records and no times, so they 
+*    are read as they are and marked version 3 when opened. 
+*    Version 1 logs, written before boards had a number of 
+*    colors, hold 8-color codes of 3 bits per peg and are 
+*    upgraded when opened.
+***********************************************************/
+struct LogHeader {
+    char magic[4];      // "MMHL"
+    uint32_t version;
+};
+
+struct LogRecord {
+    uint8_t type;               // 'C', 'G' or 'R'
+    uint8_t codeLength;
+    uint8_t numColors;
+    char duplicateSetting;      // 'y' or 'n'
+    uint8_t isWin;              // 'R' records only
+    uint8_t unused[3];
+    uint64_t value;
+};
+
+struct LogRecordV1 {
+    uint8_t type;
+    uint8_t codeLength;
+    char duplicateSetting;
+    uint8_t isWin;
+    uint32_t value;
+};
+
+/************************************************************
+*    An append-only binary log of generated codes, guesses
+*    and game results, so the history survives restarts. On
+*    open the file is memory-mapped and replayed straight into
+*    the results index and hash table. A record cut short by
+*    a crash, and anything after it, is dropped.
+***********************************************************/
+class HistoryLog {
+private:
+    static const uint32_t version = 3;
+    int fd;     // Open log file, or -1
+    
+    bool upgrade(const char* path, const LogRecordV1* records, 
+                 size_t numRecords, vector<LogRecord>& upgraded);
+
+    void append(const LogRecord& record) {
+        if (fd >= 0 && write(fd, &record, sizeof(record)) != sizeof(record)) {
+            cerr << "Warning: could not save game history." << endl;
+        }
+    }
+
+public:
+    // Constructor
+    HistoryLog() {
+        fd = -1;
+    }
+
+    // Destructor
+    ~HistoryLog() {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    HistoryLog(const HistoryLog&) = delete;
+    HistoryLog& operator=(const HistoryLog&) = delete;
+
+    bool open(const char* path, ResultsIndex& results, HashTable& hashTable, 
+              IssuedCodes* issued = nullptr);
+
+    // Save a generated secret code
+    void appendCode(const Code& code, int numColors, char duplicateSetting) {
+        LogRecord record = {'C', static_cast<uint8_t>(code.size()),
+                            static_cast<uint8_t>(numColors), duplicateSetting, 
+                            0, {0, 0, 0}, code.bits};
+        append(record);
+    }
+
+    // Save a finished game and, if given, its `gr.turnsUsed` guesses
+    void appendResult(const GameResult& gr, const Code* guesses = nullptr) {
+        LogRecord record = {'G', static_cast<uint8_t>(gr.codeLength),
+                            static_cast<uint8_t>(gr.numColors), 
+                            gr.duplicateSetting, 0, {0, 0, 0}, 0};
+        for (int i = 0; guesses != nullptr && i < gr.turnsUsed; i++) {
+            record.value = guesses[i].bits;
+            append(record);
+        }
+        record.type = 'R';
+        record.isWin = gr.isWin;
+        record.value = static_cast<uint64_t>(gr.turnsUsed) | 
+                       static_cast<uint64_t>(gr.elapsedMs) << 8;
+        append(record);
+    }
+};
+
+// Ways the solver can rank a guess by the partition it makes
+enum SolverStrategy { MINIMAX = 1, EXPECTED_SIZE = 2, MAX_ENTROPY = 3, 
+                      FIRST_CONSISTENT = 4 };
+
+// Command-line names of the strategies, indexed by SolverStrategy
+const char* const strategyNames[] = {"", "minimax", "expected", "entropy", "first"};
+
+// The strategy called `name`, or 0 if there is none
+inline int strategyByName(const char* name) {
+    for (int i = MINIMAX; i <= FIRST_CONSISTENT; i++) {
+        if (strcmp(name, strategyNames[i]) == 0) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+/************************************************************
+*    On-disk layout of the opening book: a header followed 
+*    by one entry per stored guess. Slot 0 of a board and 
+*    strategy is the first guess; slot 1 + b * (length + 1) 
+*    + w is the reply to a first hint of b blacks and w 
+*    whites.
+***********************************************************/
+struct BookHeader {
+    char magic[4];          // "MMOB"
+    uint32_t version;
+    uint32_t numEntries;
+    uint32_t unused;
+};
+
+struct BookEntry {
+    uint16_t board;         // See boardIndex
+    uint8_t strategy;       // A SolverStrategy
+    uint8_t slot;
+    uint8_t unused[4];
+    uint64_t guess;         // Code bits
+};
+
+/************************************************************
+*    The solver's first two moves, worked out ahead of time 
+*    by --build-book, since they are the same in every game 
+*    of a board and cost the most to find while every code 
+*    is still possible. Each board and strategy the book 
+*    covers gets a table of slots (see `BookEntry`), found 
+*    through `tables`, so a lookup is two array reads.
+***********************************************************/
+class OpeningBook {
+private:
+    static const uint32_t version = 1;
+    static const int numSlots = 1 + (maxPegs + 1) * (maxPegs + 1);
+    static const int numStrategies = FIRST_CONSISTENT + 1;
+    
+    vector<int32_t> tables;     // Per board and strategy: first slot, or -1
+    vector<Code> guesses;       // All slots; an empty code is no entry
+    size_t numEntries;
+
+public:
+    // Constructor
+    OpeningBook() : tables(numBoards * numStrategies, -1) {
+        numEntries = 0;
+    }
+    
+    // Store `guess` in a slot of a board's table
+    void add(int board, int strategy, int slot, const Code& guess) {
+        int32_t& table = tables[board * numStrategies + strategy];
+        if (table < 0) {
+            table = static_cast<int32_t>(guesses.size());
+            guesses.resize(guesses.size() + numSlots);
+        }
+        Code& entry = guesses[table + slot];
+        numEntries += (entry.bits == 0);
+        entry = guess;
+    }
+    
+    // The guess in a slot of a board's table; false if there is none
+    bool lookup(int board, int strategy, int slot, Code& guess) const {
+        int32_t table = tables[board * numStrategies + strategy];
+        if (table < 0 || guesses[table + slot].bits == 0) {
+            return false;
+        }
+        guess = guesses[table + slot];
+        return true;
+    }
+    
+    // Slot of the reply to a first hint on a board of `length` pegs
+    static int replySlot(int length, const Feedback& fb) {
+        return 1 + fb.black * (length + 1) + fb.white;
+    }
+    
+    size_t size() const {
+        return numEntries;
+    }
+    
+    bool load(const char* path);
+    bool save(const char* path) const;
+};
+
+/************************************************************
+*    Plays the guesser's side of the game. Keeps every code 
+*    still consistent with the feedback so far and picks the 
+*    candidate whose feedback partition of the remaining 
+*    codes is best for the chosen strategy (minimax over the 
+*    consistent candidates, smallest expected partition, or 
+*    maximum entropy), or simply the first consistent 
+*    candidate. Only candidates are tried as guesses, unlike 
+*    Knuth's minimax, which searches every code, so the 
+*    results are a little worse than his. Guess evaluation 
+*    is split across all cores and stops when the per-move 
+*    time budget runs out. Only boards of up to `maxCodes` 
+*    codes can be solved, since every code is kept in memory.
+***********************************************************/
+class Solver {
+private:
+    vector<Code> candidates;    // Codes consistent with all feedback so far
+    const EngineOps* engine;    // Scoring for the game's settings
+    int length;                 // Number of pegs
+    SolverStrategy strategy;    // How partitions are ranked
+    double timeBudget;          // Seconds allowed per move
+    int numThreads;             // Worker threads for evaluation and filtering
+    const OpeningBook* book;    // Known first moves, if any
+    int board;                  // See boardIndex
+    int bookSlot;               // Book slot of the next guess, -1 once past it
+
+    double evaluateGuess(const Code& guess, vector<Feedback>& scratch) const;
+
+public:
+    static constexpr uint64_t maxCodes = 1u << 24;  // 8 pegs of 8 colors
+    
+    // Constructor
+    Solver(int length, int colors, char choiceDuplicate, 
+           SolverStrategy strategy, double timeBudget, 
+           const OpeningBook* book = nullptr) {
+        this->engine = &selectEngine(length, choiceDuplicate);
+        this->length = length;
+        this->strategy = strategy;
+        this->timeBudget = timeBudget;
+        this->numThreads = max(1u, thread::hardware_concurrency());
+        this->book = book;
+        this->board = boardIndex(length, colors, choiceDuplicate);
+        this->bookSlot = (book != nullptr) ? 0 : -1;
+        enumerateCodes(length, colors, choiceDuplicate, candidates);
+    }
+    
+    // Solver for a position where only `candidates` are still possible
+    Solver(int length, int colors, char choiceDuplicate, 
+           SolverStrategy strategy, double timeBudget, vector<Code>&& candidates) 
+        : candidates(move(candidates)) {
+        this->engine = &selectEngine(length, choiceDuplicate);
+        this->length = length;
+        this->strategy = strategy;
+        this->timeBudget = timeBudget;
+        this->numThreads = max(1u, thread::hardware_concurrency());
+        this->book = nullptr;
+        this->board = boardIndex(length, colors, choiceDuplicate);
+        this->bookSlot = -1;
+    }
+    
+    // Whether a board is small enough for the solver
+    static bool canSolve(int length, int colors, char choiceDuplicate) {
+        return codeSpace(length, colors, choiceDuplicate) <= maxCodes;
+    }
+    
+    // Number of codes still consistent with the feedback
+    size_t remaining() const {
+        return candidates.size();
+    }
+    
+    // Use at most `threads` threads per move
+    void setThreads(int threads) {
+        numThreads = max(1, threads);
+    }
+    
+    Code nextGuess() const;
+    Code bestOf(const vector<Code>& guesses) const;
+    void update(const Code& guess, const Feedback& fb);
+};
+
+int main(int argc, char* argv[]) 
+{
+    queue<GameResult> resultsQueue;
+    char playAgain = 'y';    
+    GameSession session;
+    char choiceDuplicate;
+    int length;
+    int colors;
+    char choiceSolver;
+    string guess_input;
+    bool quit = false;
+    ResultsIndex results;
+    const int tableSize = 8;
+    const char* historyFile = "Mastermind_History.dat";
+    const char* bookFile = "Mastermind_Book.dat";
+    
+    const double solverBudget = 1.0; // Seconds the solver may think per move
+    
+    HashTable hashTable(tableSize);
+    CandidateSet candidates;    // Codes that still fit the player's hints
+    GameTrace trace;            // Start time and guesses of the current game
+    
+#ifdef MASTERMIND_METRICS
+    atexit(dumpMetricsAtExit);
+#endif
+    
+    // Headless simulation: mastermind --batch <games> <length> ...
+    if (argc > 1 && strcmp(argv[1], "--batch") == 0) {
+        return runBatch(argc, argv);
+    }
+    
+    // Replay a script of games: mastermind --replay <script> [golden]
+    if (argc > 1 && strcmp(argv[1], "--replay") == 0) {
+        return runReplay(argc, argv);
+    }
+    
+    // Opening book: mastermind --build-book <file> [budget]
+    if (argc > 1 && strcmp(argv[1], "--build-book") == 0) {
+        return runBuildBook(argc, argv);
+    }
+    
+    // Grade a strategy: mastermind --evaluate <length> <y|n> <strategy> ...
+    if (argc > 1 && strcmp(argv[1], "--evaluate") == 0) {
+        return runEvaluate(argc, argv);
+    }
+    
+    // Aggregate the saved games: mastermind --report [history file]
+    if (argc > 1 && strcmp(argv[1], "--report") == 0) {
+        return runReport(argc, argv);
+    }
+    
+    // Microbenchmarks: mastermind --bench [output.json]
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) {
+        return runBench(argc, argv);
+    }
+    
+    // Allocation check: mastermind --alloc-check [games] [--threads <n>]
+    if (argc > 1 && strcmp(argv[1], "--alloc-check") == 0) {
+#ifdef MASTERMIND_ALLOC_CHECK
+        return runAllocCheck(argc, argv);
+#else
+        cerr << "Error: --alloc-check needs a build with "
+                "-DMASTERMIND_ALLOC_CHECK." << endl;
+        return 1;
+#endif
+    }
+    
+    // Game server: mastermind --serve <port> [workers]
+    if (argc > 1 && strcmp(argv[1], "--serve") == 0) {
+        return runServer(argc, argv);
+    }
+    
+    // Options: mastermind [--output quiet|summary|full] [--unique]
+    IssuedCodes issuedCodes;
+    IssuedCodes* issued = nullptr;  // Set when secret codes may not repeat
+    for (int arg = 1; arg < argc; arg++) {
+        if (strcmp(argv[arg], "--output") == 0) {
+            const char* levelNames[] = {"quiet", "summary", "full"};
+            int level = -1;
+            for (int i = QUIET; i <= FULL; i++) {
+                if (arg + 1 < argc && strcmp(argv[arg + 1], levelNames[i]) == 0) {
+                    level = i;
+                }
+            }
+            if (level < 0) {
+                cerr << "Usage: " << argv[0] 
+                     << " --output <quiet|summary|full>" << endl;
+                return 1;
+            }
+            renderer.setLevel(static_cast<OutputLevel>(level));
+            arg++;
+        } else if (strcmp(argv[arg], "--unique") == 0) {
+            issued = &issuedCodes;
+        } else {
+            cerr << "Usage: " << argv[0] 
+                 << " [--output <quiet|summary|full>] [--unique]" << endl;
+            return 1;
+        }
+    }
+    
+    setupGame(static_cast<unsigned int>(time(0)));    //Setting up the random function
+    printWelcome();
+    
+    // Reload the games and codes of earlier runs, then keep saving new ones
+    HistoryLog historyLog;
+    auto loadStart = chrono::steady_clock::now();
+    if (historyLog.open(historyFile, results, hashTable, issued)) {
+        results.setLog(&historyLog);
+        if (results.size() > 0) {
+            cout << "Loaded " << results.size() << " games from " << historyFile 
+                 << " in " << chrono::duration<double, milli>(
+                        chrono::steady_clock::now() - loadStart).count() 
+                 << " ms" << endl;
+        }
+    } else {
+        cerr << "Warning: cannot use " << historyFile 
+             << "; this session's games will not be saved." << endl;
+    }
+    
+    // The solver's first two moves, if a book has been built
+    OpeningBook openingBook;
+    struct stat bookInfo;
+    if (stat(bookFile, &bookInfo) == 0) {
+        if (openingBook.load(bookFile)) {
+            cout << "Loaded " << openingBook.size() << " opening moves from " 
+                 << bookFile << endl;
+        } else {
+            cerr << "Warning: " << bookFile << " is not a valid opening book; "
+                    "ignoring it." << endl;
+            openingBook = OpeningBook();
+        }
+    }
+    
+    do {
+        bool skipTurn = false; // Flag to skip the turn without using `continue`
+        playAgain = tolower(playAgain);
+        
+        if(playAgain == 'y') {
+            // Get valid code length and number of colors
+            length = getCodeLength();
+            colors = getColorCount();
+
+            // Get valid choice for duplicates
+            choiceDuplicate = getDuplicateChoice();
+            if (choiceDuplicate == 'n' && colors < length) {
+                cout << "There are fewer colors than pegs, so duplicates are "
+                        "allowed." << endl;
+                choiceDuplicate = 'y';
+            }
+            
+            // Let the computer play the guesser instead of the user
+            if (Solver::canSolve(length, colors, choiceDuplicate)) {
+                choiceSolver = getSolverChoice();
+            } else {
+                cout << "This board is too large for the computer to solve." << endl;
+                choiceSolver = 'n';
+            }
+
+            // Every code of this setting has been played: start over
+            if (!session.start(length, colors, choiceDuplicate, codeGenerator, 
+                               issued)) {
+                cout << "\nAll " << length << "-digit codes have been played; "
+                        "starting over." << endl;
+                issued->reset(length, colors, choiceDuplicate);
+                session.start(length, colors, choiceDuplicate, codeGenerator, issued);
+            }
+            hashTable.insert(session.getCode(), 
+                             boardIndex(length, colors, choiceDuplicate));
+            historyLog.appendCode(session.getCode(), colors, choiceDuplicate);
+            results.reserve(length, colors, choiceDuplicate);
+            trace.begin();
+//            cout << "\t\tCODE: ";
+//            printCode(session.getCode());
+
+            if (choiceSolver == 'y') {
+                Solver solver(length, colors, choiceDuplicate, 
+                              static_cast<SolverStrategy>(getSolverStrategy()), 
+                              solverBudget, &openingBook);
+                
+                while (session.isPlaying()) {
+                    Code solverGuess = solver.nextGuess();
+                    cout << "\nComputer guess: " << solverGuess.toString() 
+                         << " (" << solver.remaining() << " possible codes)" 
+                         << endl;
+                    compareGuess(session, solverGuess.toString(), results, true, 
+                                 nullptr, &trace);
+                    solver.update(solverGuess, 
+                                  scoreGuess(solverGuess, session.getCode()));
+                }
+            } else {
+                cout << "\nWrite a code using the symbols from 1 to " 
+                     << Code::symbol(colors - 1) << ". You have " 
+                     << session.getTurnLimit() << " turns to guess the code.\n";
+                candidates.reset(length, colors, choiceDuplicate);
+            }
+
+            while (session.isPlaying() && !quit) {    
+                skipTurn = false; // Reset skipTurn flag at the start of each turn
+                cout << "Type 'exit' anytime to quit the game." << endl;
+                cout << "Type 'tutorial' to see game's instructions." << endl;
+                cout << "\nGuess: ";
+                cin >> guess_input;
+
+                // Check for exit command
+                if (guess_input == "exit") {
+                    exitingGame(quit);
+                    skipTurn = true; // Skip rest of the loop for re-confirmation
+                }
+                
+                if (guess_input == "tutorial") {
+                    showInstructions();
+                    skipTurn = true;
+                }
+                
+#ifdef MASTERMIND_METRICS
+                // Dump the instrumentation collected so far
+                if (guess_input == "metrics") {
+                    metrics.writeJson(cout);
+                    skipTurn = true;
+                }
+#endif
+
+                // Check the guess; an error code skips the turn
+                if(!skipTurn){
+                    validInput(guess_input, skipTurn, length, colors);
+                }
+
+                // Play the guess as the next turn
+                if(!skipTurn){
+                    compareGuess(session, guess_input, results, true, &candidates, 
+                                 &trace);
+                }
+            }
+
+            if (!quit) {
+                showGameOverMessage(session.getCode());
+                displayStatistics(results);
+                printSortedScores(results);  //Statistics after each game
+                printHashTable(hashTable);
+                renderer.flush();           // One write per game
+                newGame(playAgain);
+            }
+        }
+    } while (playAgain == 'y' && !quit);
+
+    return 0;
+}
+
+/************************************************************
+*    Generates a random code for the Mastermind game based on
+*    the specified length, colors and duplicate setting, using the 
+*    game's generator (seeded by `setupGame`) unless a thread 
+*    passes its own. With `issued`, only codes not issued 
+*    before are drawn; returns false when none are left.
+ ***********************************************************/
+bool genCode(int length, int colors, Code& code, char choice, 
+             CodeGenerator& generator, IssuedCodes* issued) {
+    METRIC_TIMER(PHASE_GEN_CODE);
+    if (issued != nullptr) {
+        return issued->drawUnused(length, colors, choice, generator, code);
+    }
+    code = selectEngine(length, choice).generate(generator, colors);
+    return true;
+}
+
+/************************************************************
+*    Displays the generated code sequence by printing each 
+*    character in the code list.
+ ***********************************************************/
+void printCode(const Code& code) {
+    cout << code.toString() << endl;
+}
+
+/************************************************************
+*    Counts how many times each color appears in a code. 
+*    The count for peg value `v` lives in bits 4v to 4v + 3 
+*    of the result (a code has at most 15 pegs, so a count 
+*    always fits), and two count vectors can be compared 16 
+*    colors at a time.
+***********************************************************/
+uint64_t colorCounts(const Code& code) {
+    uint64_t counts = 0;
+    uint64_t bits = code.bits;
+    for (int i = code.size(); i > 0; i--, bits >>= 4) {
+        counts += 1ull << (4 * (bits & 15));
+    }
+    return counts;
+}
+
+/************************************************************
+*    Scores a guess against a code without printing. Black 
+*    pegs come from comparing the 4-bit fields of both codes 
+*    at once; white pegs are the sum over colors of the 
+*    smaller of both per-color counts, minus the blacks.
+***********************************************************/
+static inline Feedback scoreCounts(uint64_t guessBits, uint64_t guessCounts, 
+                                   uint64_t codeBits, uint64_t codeCounts, 
+                                   int length) {
+    // A field of the XOR is zero exactly where the pegs match
+    uint64_t diff = (guessBits ^ codeBits) & 0x0FFFFFFFFFFFFFFFull;
+    diff = (diff | (diff >> 1) | (diff >> 2) | (diff >> 3)) & 0x0111111111111111ull;
+    int black = length - countFields(diff);
+    int common = commonColors(guessCounts, codeCounts, length < 8);
+    
+    Feedback fb;
+    fb.black = static_cast<uint8_t>(black);
+    fb.white = static_cast<uint8_t>(common - black);
+    return fb;
+}
+
+Feedback scoreGuess(const Code& guess, const Code& code) {
+    return scoreCounts(guess.bits, colorCounts(guess), code.bits, 
+                       colorCounts(code), guess.size());
+}
+
+/************************************************************
+*    Scores one guess against `n` contiguous candidate codes 
+*    and writes one `Feedback` per candidate to `out`. The 
+*    length is only known at run time, so counting each 
+*    candidate's colors loops once per peg and the loop does 
+*    not vectorize. Callers that score many candidates of 
+*    one board should use `EngineOps::scoreBatch` from 
+*    `selectEngine`, whose loops have a fixed trip count.
+***********************************************************/
+void scoreBatch(const Code& guess, const Code* codes, size_t n, Feedback* out) {
+    uint64_t guessBits = guess.bits;
+    uint64_t guessCounts = colorCounts(guess);
+    int length = guess.size();
+    
+    for (size_t i = 0; i < n; i++) {
+        out[i] = scoreCounts(guessBits, guessCounts, codes[i].bits, 
+                             colorCounts(codes[i]), length);
+    }
+}
+
+/************************************************************
+*    Generates a hint to guide the player by indicating 
+*    the number of correct and misplaced digits in the guess.
+*    The hint shows:
+*      - 'O' for correct digits in correct positions.
+*      - 'X' for correct digits in incorrect positions.
+*      - '_' for incorrect digits.
+ ***********************************************************/
+void hint(const Code& code, const Code& guess, bool verbose) {
+    METRIC_TIMER(PHASE_HINT);
+    const EngineOps& engine = selectEngine(code.size(), 'y');
+    Feedback fb = engine.score(guess, code);
+    if (!verbose) {
+        return;
+    }
+    renderer.stream() << "Hint: " << engine.hint(fb) << '\n';
+}
+
+/************************************************************
+*    Initializes the random number generator with the given 
+*    seed. The interactive game seeds it with the current time 
+*    to ensure different random sequences in each game; batch 
+*    runs pass a fixed seed so they can be reproduced.
+ ***********************************************************/
+void setupGame(unsigned int seed){
+    codeGenerator.setSeed(seed);
+}
+
+/************************************************************
+*    Reports a rejected answer to one of the prompts below 
+*    and skips the rest of the line, so the prompt can be 
+*    asked again.
+ ***********************************************************/
+static void rejectInput(const char* error) {
+    cout << "Error: " << error << endl;
+    cin.clear();
+    cin.ignore(100, '\n');
+}
+
+/************************************************************
+*    Prompts the user to select a code length for the game 
+*    and validates the input, ensuring it is 1 to 15 (the 
+*    classic boards are 4, 6 and 8).
+ ***********************************************************/
+int getCodeLength(){
+    int length = 0;
+    
+    do {
+        cout << "Choose the code length: " << endl;
+        cout << "4" << endl;
+        cout << "6" << endl;
+        cout << "8" << endl;
+        cout << "(or any length from 1 to " << maxPegs << ")" << endl;
+        cin >> length;
+        if (cin.fail()){ 
+            rejectInput("Invalid input type. Please enter a number.");
+            length = 0;
+        } else if (length < 1 || length > maxPegs){ 
+            rejectInput("Invalid code length. Please enter 1 to 15.");
+        }
+    } while (length < 1 || length > maxPegs);
+    
+    return length;    
+}
+
+/************************************************************
+*    Prompts the user to select how many colors the code may 
+*    use and validates the input, ensuring it is 2 to 16 
+*    (the classic game uses 8).
+ ***********************************************************/
+int getColorCount(){
+    int colors = 0;
+    
+    do {
+        cout << "Choose the number of colors (2 to " << maxColors 
+             << ", classic is 8): ";
+        cin >> colors;
+        if (cin.fail()){ 
+            rejectInput("Invalid input type. Please enter a number.");
+            colors = 0;
+        } else if (colors < 2 || colors > maxColors){ 
+            rejectInput("Invalid number of colors. Please enter 2 to 16.");
+        }
+    } while (colors < 2 || colors > maxColors);
+    
+    return colors;    
+}
+
+/************************************************************
+*    Prompts the user to decide if duplicates are allowed in 
+*    the game code, validating the input as either 'y' or 
+*    'n'.
+ ***********************************************************/
+char getDuplicateChoice(){
+    char choiceDuplicate = '\0';
+    
+    do {
+        cout << "Do you want to play with duplicates? [y/n]: ";
+        cin >> choiceDuplicate;
+        if (cin.fail()){ 
+            rejectInput("Invalid input type. Please enter 'y' or 'n'.");
+            choiceDuplicate = '\0';
+            continue;
+        }
+        choiceDuplicate = tolower(choiceDuplicate);
+        if (choiceDuplicate != 'y' && choiceDuplicate != 'n'){ 
+            rejectInput("Invalid choice. Please enter 'y' or 'n'.");
+        }
+    } while (choiceDuplicate != 'y' && choiceDuplicate != 'n');
+    
+    return choiceDuplicate;
+}
+
+/************************************************************
+*    Asks the user if the computer should play the guesser 
+*    for this game, validating the input as either 'y' or 
+*    'n'.
+ ***********************************************************/
+char getSolverChoice(){
+    char choiceSolver = '\0';
+    
+    do {
+        cout << "Do you want the computer to solve the code? [y/n]: ";
+        cin >> choiceSolver;
+        if (cin.fail()){ 
+            rejectInput("Invalid input type. Please enter 'y' or 'n'.");
+            choiceSolver = '\0';
+            continue;
+        }
+        choiceSolver = tolower(choiceSolver);
+        if (choiceSolver != 'y' && choiceSolver != 'n'){ 
+            rejectInput("Invalid choice. Please enter 'y' or 'n'.");
+        }
+    } while (choiceSolver != 'y' && choiceSolver != 'n');
+    
+    return choiceSolver;
+}
+
+/************************************************************
+*    Prompts the user to select the strategy the computer 
+*    uses to choose its guesses, ensuring it is 1, 2, 3, or 4.
+ ***********************************************************/
+int getSolverStrategy(){
+    int strategy = 0;
+    
+    do {
+        cout << "Choose the solver strategy: " << endl;
+        cout << "1. Minimax (smallest worst case)" << endl;
+        cout << "2. Smallest expected partition" << endl;
+        cout << "3. Maximum entropy" << endl;
+        cout << "4. First consistent code (fastest)" << endl;
+        cin >> strategy;
+        if (cin.fail()){ 
+            rejectInput("Invalid input type. Please enter a number.");
+            strategy = 0;
+        } else if (strategy < MINIMAX || strategy > FIRST_CONSISTENT){ 
+            rejectInput("Invalid strategy. Please enter 1, 2, 3, or 4.");
+        }
+    } while (strategy < MINIMAX || strategy > FIRST_CONSISTENT);
+    
+    return strategy;
+}
+
+/************************************************************
+*    Displays the end-of-game message, reveals the correct 
+*    code, and displays a game over message.
+ ***********************************************************/
+void showGameOverMessage(const Code &code){
+    renderer.stream() << "\nThe code was: " << code.toString() << '\n';
+    printGameOver(); 
+}
+
+/************************************************************
+*    Ask the user if he or she wants to play again. If the
+*    the user responds 'y', the game will start over with a
+*    new secret code. If 'n', the program ends.
+ ***********************************************************/
+void newGame(char &playAgain){
+    cout << "\nDo you want to play again? [y/n]: ";
+    cin >> playAgain;
+    playAgain = tolower(playAgain);
+    if (playAgain == 'n') {
+        cout << "Thanks for playing! Goodbye!" << endl;
+    }
+}
+
+/************************************************************
+*    Displays the instructions for the Mastermind game, 
+*    explaining the rules, the goal of the game, how guesses 
+*    and hints work, and how to enter valid inputs.
+ ***********************************************************/
+void showInstructions(){
+    for(int i = 0 ; i < 80; i++){
+        cout << "*";
+    }
+    
+    cout << endl;
+    cout << "*\t\t\tThis is Mastermind!" << endl << "*" << endl;
+    cout << "*\tThe goal of the game is to guess the code the computer generated.";
+    cout << endl << "*" << endl;
+    cout << "*\tYou have 10 attempts to guess the code (more on boards with "
+            "\n*\tmore than 8 pegs or colors)." << endl;
+    cout << "*\tIn order to enter your guess, please type numbers from 1 to 8, "
+            "\n*\taccording to the code size you selected (4, 6 or 8 digits). "
+            "\n*\tBoards with more colors use 9 and then the letters A to G.";
+    cout << endl << "*" << endl;
+    cout << "*\tFor every guess you entered, you will be given a hint in the form:";
+    cout << endl << "*" << endl;
+    cout << "*\tOOX_" << endl << "*" << endl;
+    cout << "*\tThe symbols above represents the amount of digits in the right "
+            "\n*\tposition, wrong position and incorrect digits from your guess: ";
+    cout << endl;
+    cout << "*\tO: One digit in the right position." << endl;
+    cout << "*\tX: One digit in the wrong position. " << endl;
+    cout << "*\t_: One incorrect digit." << endl << "*" << endl;    
+    cout << "*\tFor instance, if the secret code is '1234' and your guess was "
+            "\n*\t'5247', the hint will be OX__, because '2' was in the right "
+            "\n*\tposition, '4' was in the wrong position and '5' and '7' were "
+            "\n*\tincorrect digits. As you can notice, the hint does not show you "
+            "\n*\twhat digit's place was right, wrong or incorrect, it only shows "
+            "\n*\tthe amount." << endl << "*" << endl;
+    cout << "*\t\t\tHAPPY GUESSING! :D" << endl;
+    
+    for(int i = 0 ; i < 80; i++){
+        cout << "*";
+    }
+    cout << endl;
+}
+
+/************************************************************
+*    Checks a typed guess for a game of `length` pegs and 
+*    `colors` colors and returns what is wrong with it, if 
+*    anything. Only branches and compares, so malformed 
+*    input costs no more than good input.
+ ***********************************************************/
+InputError checkGuess(string_view guess, int length, int colors) {
+    // Well-formed guesses pass the length's engine without the checks below
+    if (length >= 1 && length <= maxPegs && 
+        selectEngine(length, 'y').valid(guess, colors)) {
+        return INPUT_OK;
+    }
+    if (guess.empty()) {
+        return INPUT_EMPTY;
+    }
+    for (char ch : guess) {
+        if (!isalnum(static_cast<unsigned char>(ch))) {
+            return INPUT_BAD_CHARACTERS;
+        }
+    }
+    if (guess.size() != static_cast<size_t>(length)) {
+        return INPUT_WRONG_LENGTH;
+    }
+    return INPUT_BAD_SYMBOLS;
+}
+
+/************************************************************
+*    Appends the message for a rejected guess to `text`; the 
+*    board's `colors` give the last symbol that may be used.
+ ***********************************************************/
+void appendInputError(string& text, InputError error, int colors) {
+    switch (error) {
+        case INPUT_OK:
+            break;
+        case INPUT_EMPTY:
+            text += "Input cannot be empty. Please try again.";
+            break;
+        case INPUT_BAD_CHARACTERS:
+            text += "Guess contains invalid characters. Use only 1 to ";
+            text += Code::symbol(colors - 1);
+            text += '.';
+            break;
+        case INPUT_WRONG_LENGTH:
+            text += "Guess length does not match the code length.";
+            break;
+        case INPUT_BAD_SYMBOLS:
+            text += "Guess contains invalid symbols. Only use 1 to ";
+            text += Code::symbol(colors - 1);
+            text += '.';
+            break;
+    }
+}
+
+/************************************************************
+*    Validates the player's guess input for correctness 
+*    in terms of format, length, and valid characters (1 to 
+*    the last of the board's `colors` symbols). Errors are 
+*    written to `out`.
+ ***********************************************************/
+void validInput(const string &guess_input, bool &skipTurn, const int &length, 
+                int colors, ostream& out){
+    InputError error = checkGuess(guess_input, length, colors);
+    if (error != INPUT_OK) {
+        string message;
+        appendInputError(message, error, colors);
+        out << "Error: " << message << endl;
+        skipTurn = true; // Skip turn if an invalid guess was made
+    }
+}
+
+/************************************************************
+*    Plays the player's guess as the next turn of `session`, 
+*    provides feedback through hints, narrows `candidates` 
+*    (if given) to the codes that fit every hint so far, adds 
+*    the guess to `trace` (if given), and records the result 
+*    once the game is won or lost. Nothing is printed unless 
+*    `verbose` is set.
+ ***********************************************************/
+void compareGuess(GameSession& session, const string& guess_input, 
+                  ResultsIndex& results, bool verbose, CandidateSet* candidates, 
+                  GameTrace* trace) {
+    METRIC_TIMER(PHASE_COMPARE_GUESS);
+    Code guess = Code::fromString(guess_input);
+    Feedback fb = session.submit(guess);
+    if (trace != nullptr) {
+        trace->guesses.push_back(guess);
+    }
+    if (candidates != nullptr && !session.isWon()) {
+        candidates->update(guess, fb);
+    }
+
+    if (verbose) {
+        ostream& out = renderer.stream();
+        if (session.isWon()) {
+            out << "Congratulations!! You win !!\n"; 
+        } else {
+            out << "Hint: " << session.hintText(fb) << '\n';
+            if (candidates != nullptr && candidates->isTracking()) {
+                out << "Possible codes left: " << candidates->remaining() << '\n';
+            }
+            out << "Turns left: " << session.getTurnsLeft() << '\n';
+        }
+        renderer.flush();   // One write per turn
+    }
+    
+    if (session.isOver()) {
+        recordResult(session.getLength(), session.getColors(), 
+                     session.getDuplicateChoice(), session.isWon(), 
+                     session.getTurnsUsed(), results, trace);
+    }
+}
+
+/************************************************************
+*    Starts a new game with a fresh secret code from 
+*    `generator`, never one already in `issued` if given. 
+*    Returns false, leaving the session as it was, when 
+*    every code of the setting has been issued.
+***********************************************************/
+bool GameSession::start(int length, int colors, char choiceDuplicate, 
+                        CodeGenerator& generator, IssuedCodes* issued) {
+    if (!genCode(length, colors, code, choiceDuplicate, generator, issued)) {
+        return false;
+    }
+    engine = &selectEngine(length, choiceDuplicate);
+    this->length = static_cast<uint8_t>(length);
+    this->colors = static_cast<uint8_t>(colors);
+    this->choiceDuplicate = choiceDuplicate;
+    turnLimit = static_cast<uint8_t>(::turnLimit(length, colors));
+    turnsUsed = 0;
+    state = PLAYING;
+    return true;
+}
+
+/************************************************************
+*    Plays one turn: scores `guess` against the secret code 
+*    and ends the game on a win or when the turns run out. 
+*    The guess must already be valid for this game.
+***********************************************************/
+Feedback GameSession::submit(const Code& guess) {
+    Feedback fb = engine->score(guess, code);
+    turnsUsed++;
+    if (fb.black == length) {
+        state = WON;
+    } else if (turnsUsed >= turnLimit) {
+        state = LOST;
+    }
+    return fb;
+}
+
+/************************************************************
+*    Asks the player for confirmation to exit the game and 
+*    sets the quit flag if the player confirms.
+ ***********************************************************/
+void  exitingGame(bool &quit){
+    char confirm;
+    cout << "Are you sure you want to quit? [y/n]: ";
+    cin >> confirm;
+    if (tolower(confirm) == 'y') {
+        cout << "Exiting game. Thanks for playing!" << endl;
+        quit = true; // Set quit flag to exit loop
+    }    
+}
+
+/************************************************************
+*    Records the outcome of a single game (win/loss), its 
+*    settings and the turns it took into the results index, 
+*    along with the time taken and the guesses played if the 
+*    game was traced.
+ ***********************************************************/
+void recordResult(int codeLength, int numColors, char duplicateSetting, 
+                  bool isWin, int turnsUsed, ResultsIndex& results, 
+                  const GameTrace* trace) {
+    GameResult gr(codeLength, numColors, duplicateSetting, isWin, turnsUsed, 
+                  trace != nullptr ? trace->elapsedMs() : 0);
+    // Update the totals, the history tree and the columns
+    results.insert(gr, trace != nullptr ? trace->guesses.data() : nullptr);
+}
+
+/************************************************************
+*    Displays the statistics of the game results, including 
+*    wins and losses for every code length and number of 
+*    colors played with and without duplicates, and compares 
+*    the number of wins with and without duplicates. Served 
+*    from the per-setting totals, so the cost does not grow 
+*    with the history. At the FULL output level the game 
+*    history is listed too, with the aggregates of its 
+*    columnar store.
+ ***********************************************************/
+void displayStatistics(const ResultsIndex& results) {
+    METRIC_TIMER(PHASE_DISPLAY_STATISTICS);
+    ostream& out = renderer.stream();
+    
+    if (renderer.getLevel() == QUIET) {
+        return;
+    }
+    
+    out << "\nSTATISTICS (" << results.size() << " games):\n";
+    for (int board = 0; board < numBoards / 2; board++) {
+        int length = board / maxColors + 1;
+        int colors = board % maxColors + 1;
+        long winsByDuplicates[2] = {0, 0};
+        for (char dup : {'n', 'y'}) {
+            const ConfigStats& config = results.getStats(length, colors, dup);
+            long games = config.wins + config.losses;
+            if (games == 0) {
+                continue;
+            }
+            winsByDuplicates[dup == 'y'] = config.wins;
+            out << "Code Length: " << length << " - Colors: " << colors << " - ";
+            out << (dup == 'y' ? "Duplicates" : "No duplicates");
+            out << " - Wins: " << config.wins << " - Losses: " << config.losses;
+            out << " - Avg turns: " 
+                << static_cast<double>(config.turnsUsed) / games << '\n';
+        }
+        if (winsByDuplicates[0] + winsByDuplicates[1] > 0) {
+            out << "Code Length: " << length << " - Colors: " << colors 
+                << " - Wins with duplicates: " 
+                << winsByDuplicates[1] << " vs without: " 
+                << winsByDuplicates[0] << '\n';
+        }
+    }
+    
+    if (renderer.getLevel() == FULL) {
+        out << "\nSCORES IN HISTORY ORDER:\n";
+        printInOrder(results.getRoot());
+        out << "\nGAME HISTORY REPORT:\n";
+        printHistoryReport(results.getHistory(), out);
+    }
+    out << '\n';
+}
+
+/************************************************************
+*    Create a visually striking title screen for the game.
+ ***********************************************************/
+void printWelcome(){
+    cout << endl;
+    cout << "              (           )    *                    )      *      "
+            "     (             (      *    (       ) (      " << endl;
+    cout << " (  (         )\\ )  (  ( /(  (  `          *   ) ( /(    (  `    ("
+            "     )\\ ) *   )    )\\ ) (  `   )\\ ) ( /( )\\ )   " << endl;
+    cout << " )\\))(   '(  (()/(  )\\ )\\()) )\\))(  (    ` )  /( )\\())   )\\))(   )"
+            "\\   (()/` )  /((  (()/( )\\))( (()/( )\\()(()/(   " << endl;
+    cout << "((_)()\\ ) )\\  /(_)(((_((_)\\ ((_)()\\ )\\    ( )(_)((_)\\   ((_)()(((("
+            "_)(  /(_)( )(_))\\  /(_)((_)()\\ /(_)((_)\\ /(_))  " << endl;
+    cout << "_(())\\_)(((_)(_)) )\\___ ((_)(_()((_((_)  (_(_())  ((_)  (_()((_)\\ "
+            "_ )\\(_))(_(_()((_)(_)) (_()((_(_))  _((_(_))_   " << endl;
+    cout << "\\ \\((_)/ | __| | ((/ __/ _ \\|  \\/  | __| |_   _| / _ \\  |  \\/  (_)"
+            "_\\(_/ __|_   _| __| _ \\|  \\/  |_ _|| \\| ||   \\  " << endl;
+    cout << " \\ \\/\\/ /| _|| |__| (_| (_) | |\\/| | _|    | |  | (_) | | |\\/| |/ "
+            "_ \\ \\__ \\ | | | _||   /| |\\/| || | | .` || |) | " << endl;
+    cout << "  \\_/\\_/ |___|____|\\___\\___/|_|  |_|___|   |_|   \\___/  |_|  |_/_/"
+            " \\_\\|___/ |_| |___|_|_\\|_|  |_|___||_|\\_||___/  " << endl << endl;    
+}
+
+/************************************************************
+*    Create a ASCII art-style game over message.
+ ***********************************************************/
+void printGameOver(){
+    ostream& out = renderer.stream();
+    out << '\n';
+    out << "  #####     #    #     # #######       #######  #     # ####### ######  \n";
+    out << " #     #   # #   ##   ## #             #     #  #     # #       #     # \n";
+    out << " #        #   #  # # # # #             #     #  #     # #       #     # \n";
+    out << " #  #### #     # #  #  # #####         #     #  #     # #####   ######  \n";
+    out << " #     # ####### #     # #             #     #   #   #  #       #   #   \n";
+    out << " #     # #     # #     # #             #     #    # #   #       #    #  \n";
+    out << "  #####  #     # #     # #######       #######     #    ####### #     # \n";
+    out << '\n';
+}
+
+/************************************************************
+*    Adds one game to the totals and leaderboard entry for 
+*    its board setting, to the per-game history tree and, 
+*    with its guesses (`gr.turnsUsed` of them, if given), to 
+*    the columnar history.
+***********************************************************/
+void ResultsIndex::insert(const GameResult& gr, const Code* guesses) {
+    int index = boardIndex(gr.codeLength, gr.numColors, gr.duplicateSetting);
+    ConfigStats& config = stats[index];
+    if (gr.isWin) {
+        config.wins++;
+    } else {
+        config.losses++;
+    }
+    config.turnsUsed += gr.turnsUsed;
+    leaderboard.addGame(index, gr.isWin);
+    
+    ::insert(root, gr, count++, arena);
+    history.append(index, gr.isWin, gr.turnsUsed, gr.elapsedMs, guesses, 
+                   guesses != nullptr ? gr.turnsUsed : 0);
+    if (log) {
+        log->appendResult(gr, guesses);
+    }
+}
+
+/************************************************************
+*    Counts the games and wins of setting `board` and the 
+*    turns they used. Each block sums into 32-bit counters, 
+*    which cannot overflow within a block.
+***********************************************************/
+GameHistory::Summary GameHistory::summarize(int board) const {
+    const Columns& column = boards[board];
+    size_t games = column.won.size();
+    Summary summary = {static_cast<long>(games), 0, 0};
+    for (size_t begin = 0; begin < games; begin += blockGames) {
+        size_t n = min(blockGames, games - begin);
+        uint32_t wins, turnsUsed;
+        if (n == blockGames) {
+            sumBlock(column.won.data() + begin, column.turns.data() + begin, 
+                     blockGames, wins, turnsUsed);
+        } else {
+            sumBlock(column.won.data() + begin, column.turns.data() + begin, 
+                     n, wins, turnsUsed);
+        }
+        summary.wins += wins;
+        summary.turnsUsed += turnsUsed;
+    }
+    return summary;
+}
+
+/************************************************************
+*    Fills `counts[t]` with the games of setting `board` won 
+*    in t turns, for t from 1 to maxTurns(board), and 
+*    `counts[0]` with the games lost. Each block is counted 
+*    once per turn value with a compare-and-add loop, which 
+*    vectorizes where scattering into the counts would not.
+***********************************************************/
+void GameHistory::turnHistogram(int board, long* counts) const {
+    const Columns& column = boards[board];
+    size_t games = column.won.size();
+    fill(counts, counts + column.maxTurns + 1, 0);
+    for (size_t begin = 0; begin < games; begin += blockGames) {
+        size_t n = min(blockGames, games - begin);
+        for (int t = 0; t <= column.maxTurns; t++) {
+            const uint8_t* won = column.won.data() + begin;
+            const uint8_t* turns = column.turns.data() + begin;
+            counts[t] += (n == blockGames) ? 
+                         countBlock(won, turns, blockGames, t) : 
+                         countBlock(won, turns, n, t);
+        }
+    }
+}
+
+/************************************************************
+*    Sets `times[i]` to the time taken at fraction 
+*    `fractions[i]` (0 to 1) of the games of setting `board`, 
+*    ordered by time. The times are counted into at most 
+*    65536 buckets of equal width, which is exact for times 
+*    up to a minute; with wider buckets, only the times in 
+*    the bucket a percentile falls in are selected from. The 
+*    setting must have games.
+***********************************************************/
+void GameHistory::elapsedPercentiles(int board, const double* fractions, int n, 
+                                     uint32_t* times) const {
+    const int bucketBits = 16;
+    const vector<uint32_t>& elapsed = boards[board].elapsedMs;
+    uint32_t largest = *max_element(elapsed.begin(), elapsed.end());
+    int shift = max(0, 32 - __builtin_clz(largest | 1) - bucketBits);
+    vector<uint64_t> buckets((largest >> shift) + 1, 0);
+    for (uint32_t ms : elapsed) {
+        buckets[ms >> shift]++;
+    }
+    
+    vector<uint32_t> inBucket;
+    for (int i = 0; i < n; i++) {
+        uint64_t rank = static_cast<uint64_t>(fractions[i] * (elapsed.size() - 1));
+        uint32_t bucket = 0;
+        while (rank >= buckets[bucket]) {
+            rank -= buckets[bucket++];
+        }
+        if (shift == 0) {
+            times[i] = bucket;
+            continue;
+        }
+        inBucket.clear();
+        for (uint32_t ms : elapsed) {
+            if ((ms >> shift) == bucket) {
+                inBucket.push_back(ms);
+            }
+        }
+        nth_element(inBucket.begin(), inBucket.begin() + rank, inBucket.end());
+        times[i] = inBucket[rank];
+    }
+}
+
+/************************************************************
+*    Returns the first guess played most often in setting 
+*    `board` and sets `games` to how often. Games saved 
+*    without their guesses are left out; if there are none, 
+*    `games` is 0. Most games of a setting open the same way, 
+*    so a run of equal openings is counted without a lookup.
+***********************************************************/
+Code GameHistory::openingGuess(int board, long& games) const {
+    const Columns& column = boards[board];
+    unordered_map<uint64_t, long> openings;
+    long* current = nullptr;        // Count of the last opening seen
+    uint64_t currentGuess = 0;
+    uint64_t start = 0;
+    for (uint64_t end : column.guessEnd) {
+        if (end > start) {
+            uint64_t guess = column.guesses[start];
+            if (current == nullptr || guess != currentGuess) {
+                current = &openings[guess];
+                currentGuess = guess;
+            }
+            (*current)++;
+        }
+        start = end;
+    }
+    
+    Code best;
+    games = 0;
+    for (const auto& opening : openings) {
+        if (opening.second > games || 
+            (opening.second == games && opening.first < best.bits)) {
+            best.bits = opening.first;
+            games = opening.second;
+        }
+    }
+    return best;
+}
+
+static int nodeHeight(TreeNode* node) {
+    return node ? node->height : 0;
+}
+
+static void updateHeight(TreeNode* node) {
+    node->height = 1 + max(nodeHeight(node->left), nodeHeight(node->right));
+}
+
+// Rotates `node`'s left child up and returns the new subtree root
+static TreeNode* rotateRight(TreeNode* node) {
+    TreeNode* child = node->left;
+    node->left = child->right;
+    child->right = node;
+    updateHeight(node);
+    updateHeight(child);
+    return child;
+}
+
+// Rotates `node`'s right child up and returns the new subtree root
+static TreeNode* rotateLeft(TreeNode* node) {
+    TreeNode* child = node->right;
+    node->right = child->left;
+    child->left = node;
+    updateHeight(node);
+    updateHeight(child);
+    return child;
+}
+
+// Restores the AVL balance of `node` and returns the new subtree root
+static TreeNode* rebalance(TreeNode* node) {
+    updateHeight(node);
+    int balance = nodeHeight(node->left) - nodeHeight(node->right);
+    if (balance > 1) {
+        if (nodeHeight(node->left->left) < nodeHeight(node->left->right)) {
+            node->left = rotateLeft(node->left);
+        }
+        return rotateRight(node);
+    }
+    if (balance < -1) {
+        if (nodeHeight(node->right->right) < nodeHeight(node->right->left)) {
+            node->right = rotateRight(node->right);
+        }
+        return rotateLeft(node);
+    }
+    return node;
+}
+
+/************************************************************
+*    Inserts a `GameResult` object into a balanced binary 
+*    search tree based on the code length, number of colors, 
+*    duplicate setting and game order. The walk down remembers each link it 
+*    follows, so rebalancing on the way back up needs no 
+*    recursion. The new node is taken from `arena`.
+***********************************************************/
+void insert(TreeNode*& root, const GameResult& gr, long order, 
+            NodeArena& arena) {
+    METRIC_TIMER(PHASE_TREE_INSERT);
+    TreeNode** path[96];    // AVL height stays below 1.45 log2(n)
+    int depth = 0;
+    TreeNode** link = &root;
+    
+    while (*link != nullptr) {
+        const TreeNode* node = *link;
+        path[depth++] = link;
+        const GameResult& other = node->result;
+        if (gr.codeLength != other.codeLength ? gr.codeLength < other.codeLength : 
+            gr.numColors != other.numColors ? gr.numColors < other.numColors : 
+            gr.duplicateSetting != other.duplicateSetting ? 
+                gr.duplicateSetting < other.duplicateSetting : 
+            order < node->order) {
+            link = &(*link)->left;
+        } else {
+            link = &(*link)->right;
+        }
+    }
+    *link = arena.create(gr, order);
+    
+    while (depth > 0) {
+        TreeNode** parent = path[--depth];
+        *parent = rebalance(*parent);
+    }
+}
+
+/************************************************************
+*    Prints every game in the history tree in order, using an 
+*    explicit stack instead of recursion, up to the 
+*    renderer's row limit.
+***********************************************************/
+void printInOrder(TreeNode* root) {
+    stack<TreeNode*> pending;
+    TreeNode* node = root;
+    ostream& out = renderer.stream();
+    size_t rows = 0;
+    
+    while (node != nullptr || !pending.empty()) {
+        while (node != nullptr) {
+            pending.push(node);
+            node = node->left;
+        }
+        node = pending.top();
+        pending.pop();
+        if (rows++ == renderer.getMaxRows()) {
+            out << "...\n";
+            return;
+        }
+        out << "Code Length: " << node->result.codeLength << " - ";
+        out << "Colors: " << node->result.numColors << " - ";
+        out << (node->result.duplicateSetting == 'y' ? "Duplicates" : "No duplicates");
+        out << " - Result: " << (node->result.isWin ? "Win" : "Loss") << '\n';
+        node = node->right;
+    }
+}
+
+/************************************************************
+*    Traverses a binary tree in order, using an explicit 
+*    stack, to extract game scores and their associated 
+*    details into a vector of pairs. This function prepares 
+*    scores for further processing, such as sorting or 
+*    display.
+***********************************************************/
+void extractScores(TreeNode* root, vector<pair<string, int>>& scores) {
+    stack<TreeNode*> pending;
+    TreeNode* node = root;
+    
+    while (node != nullptr || !pending.empty()) {
+        // Descend to the leftmost unvisited node
+        while (node != nullptr) {
+            pending.push(node);
+            node = node->left;
+        }
+        node = pending.top();
+        pending.pop();
+
+        // Process the current node: Convert GameResult to a score format
+        string key = "Length: " + to_string(node->result.codeLength) + 
+                     ", Colors: " + to_string(node->result.numColors) + ", " + 
+                     (node->result.duplicateSetting == 'y' ? "Duplicates" : "No duplicates");
+        int value = node->result.isWin ? 1 : 0; // Example scoring: 1 for a win, 0 for a loss
+        scores.emplace_back(key, value);
+
+        // Continue with the right subtree
+        node = node->right;
+    }
+}
+
+/************************************************************
+*    Merges the sorted runs [src, src + mid) and 
+*    [src + mid, src + n) into `dst`. Ties take the left run 
+*    first, which keeps the sort stable.
+***********************************************************/
+template <typename T, typename Compare>
+void mergeRuns(T* src, size_t mid, size_t n, T* dst, Compare before) {
+    size_t i = 0, j = mid, k = 0;
+    while (i < mid && j < n) {
+        if (before(src[j], src[i])) {
+            dst[k++] = std::move(src[j++]);
+        } else {
+            dst[k++] = std::move(src[i++]);
+        }
+    }
+    while (i < mid) dst[k++] = std::move(src[i++]);
+    while (j < n) dst[k++] = std::move(src[j++]);
+}
+
+/************************************************************
+*    Sorts the `n` items at `data`, using `scratch` (same 
+*    size) as the other half of a ping-pong pair: each level 
+*    sorts its halves into the buffer it does not merge into, 
+*    so nothing is copied back. The result ends up in 
+*    `scratch` when `intoScratch` is set, otherwise in `data`. 
+*    Short runs use insertion sort, and while `threads` > 1 
+*    the left half is sorted on a new thread.
+***********************************************************/
+template <typename T, typename Compare>
+void mergeSortRange(T* data, T* scratch, size_t n, bool intoScratch, 
+                    Compare before, int threads) {
+    const size_t insertionCutoff = 32;
+    const size_t parallelCutoff = 1 << 16;
+    
+    if (n <= insertionCutoff) {
+        for (size_t i = 1; i < n; i++) {
+            T item = std::move(data[i]);
+            size_t j = i;
+            for (; j > 0 && before(item, data[j - 1]); j--) {
+                data[j] = std::move(data[j - 1]);
+            }
+            data[j] = std::move(item);
+        }
+        if (intoScratch) {
+            move(data, data + n, scratch);
+        }
+        return;
+    }
+    
+    size_t mid = n / 2;
+    if (threads > 1 && n >= parallelCutoff) {
+        thread left([=]() {
+            mergeSortRange(data, scratch, mid, !intoScratch, before, threads / 2);
+        });
+        mergeSortRange(data + mid, scratch + mid, n - mid, !intoScratch, before, 
+                       threads - threads / 2);
+        left.join();
+    } else {
+        mergeSortRange(data, scratch, mid, !intoScratch, before, 1);
+        mergeSortRange(data + mid, scratch + mid, n - mid, !intoScratch, before, 1);
+    }
+    
+    if (intoScratch) {
+        mergeRuns(data, mid, n, scratch, before);
+    } else {
+        mergeRuns(scratch, mid, n, data, before);
+    }
+}
+
+/************************************************************
+*    Stable merge sort of any record type, ordered by the 
+*    comparator `before(a, b)` (true when `a` must come before 
+*    `b`). Allocates one scratch buffer for the whole sort 
+*    and spreads large inputs across all cores.
+***********************************************************/
+template <typename T, typename Compare>
+void mergeSort(vector<T>& items, Compare before) {
+    if (items.size() < 2) {
+        return;
+    }
+    vector<T> scratch(items.size());
+    int threads = max(1u, thread::hardware_concurrency());
+    mergeSortRange(items.data(), scratch.data(), items.size(), false, before, 
+                   threads);
+}
+
+/************************************************************
+*    Displays `count` entries of the leaderboard starting at 
+*    rank `first`, best first.
+***********************************************************/
+void printLeaderboard(const Leaderboard& board, int first, int count) {
+    ostream& out = renderer.stream();
+    int last = min(board.size(), first + count);
+    for (int rank = first; rank < last; rank++) {
+        int config = board.at(rank);
+        Leaderboard::writeLabel(out, config);
+        out << ", Points: " << board.getPoints(config) << '\n';
+    }
+}
+
+/************************************************************
+*    Displays the points (wins) of every board setting played 
+*    so far in sorted order. Provides a clear overview of 
+*    scores ranked by performance. The leaderboard is kept in 
+*    order as games are recorded, so nothing is sorted here.
+***********************************************************/
+void printSortedScores(const ResultsIndex& results) {
+    METRIC_TIMER(PHASE_PRINT_SORTED_SCORES);
+    const Leaderboard& board = results.getLeaderboard();
+    
+    if (renderer.getLevel() == QUIET) {
+        return;
+    }
+    renderer.stream() << "SCORES IN POINTS ORDER:\n";
+    printLeaderboard(board, 0, board.size());
+}
+
+/************************************************************
+*    Writes the aggregates of every board setting played: 
+*    games, win rate and average turns; the turns a won game 
+*    takes and the time a game takes at the 50th, 90th and 
+*    99th percentile; the most played first guess; and how 
+*    many games were won in each number of turns.
+***********************************************************/
+void printHistoryReport(const GameHistory& history, ostream& out) {
+    const double fractions[] = {0.50, 0.90, 0.99};
+    vector<long> counts;
+    
+    for (int board = 0; board < numBoards; board++) {
+        GameHistory::Summary summary = history.summarize(board);
+        if (summary.games == 0) {
+            continue;
+        }
+        counts.resize(history.maxTurns(board) + 1);
+        history.turnHistogram(board, counts.data());
+        uint32_t times[3];
+        history.elapsedPercentiles(board, fractions, 3, times);
+        long openingGames;
+        Code opening = history.openingGuess(board, openingGames);
+        
+        Leaderboard::writeLabel(out, board);
+        out << " - Games: " << summary.games << " - Win rate: " 
+            << 100.0 * summary.wins / summary.games << "% - Avg turns: " 
+            << static_cast<double>(summary.turnsUsed) / summary.games << '\n';
+        
+        // Percentiles of the won games, read off the histogram
+        out << "  Turns to win p50/p90/p99: ";
+        for (int p = 0; p < 3; p++) {
+            long rank = static_cast<long>(fractions[p] * (summary.wins - 1));
+            long seen = 0;
+            size_t t = 1;
+            while (t < counts.size() && (seen += counts[t]) <= rank) {
+                t++;
+            }
+            if (summary.wins == 0) {
+                out << '-';
+            } else {
+                out << t;
+            }
+            out << (p < 2 ? "/" : "");
+        }
+        out << " - Time p50/p90/p99: " << times[0] << "/" << times[1] << "/" 
+            << times[2] << " ms - First guess: ";
+        if (openingGames == 0) {
+            out << "-\n";
+        } else {
+            out << opening.toString() << " (" << openingGames << " games)\n";
+        }
+        
+        out << "  Won in turns:";
+        for (size_t t = 1; t < counts.size(); t++) {
+            if (counts[t] > 0) {
+                out << ' ' << t << ": " << counts[t];
+            }
+        }
+        out << " - Lost: " << counts[0] << '\n';
+    }
+}
+
+unsigned int RSHash(const Code& str)
+{
+   unsigned int b    = 378551;
+   unsigned int a    = 63689;
+   unsigned int hash = 0;
+
+   for(int i = 0; i < str.size(); i++)
+   {
+      hash = hash * a + str.digit(i);
+      a    = a * b;
+   }
+
+   return hash;
+}
+
+/************************************************************
+*    Displays the contents of a hash table, slot by slot, 
+*    followed by its load and probe-length statistics. Empty 
+*    slots are skipped and repeated codes show their count. 
+*    The contents are only listed at the FULL output level, 
+*    up to the renderer's row limit.
+***********************************************************/
+void printHashTable(const HashTable& hashTable) {
+    METRIC_TIMER(PHASE_PRINT_HASH_TABLE);
+    ostream& out = renderer.stream();
+    
+    if (renderer.getLevel() == QUIET) {
+        return;
+    }
+    
+    if (renderer.getLevel() == FULL) {
+        size_t rows = 0;
+        out << "\nHash Table Contents:\n";
+        for (size_t i = 0; i < hashTable.getCapacity(); ++i) {
+            if (!hashTable.isOccupied(i)) {
+                continue;
+            }
+            if (rows++ == renderer.getMaxRows()) {
+                out << "... " << hashTable.getEntries() - renderer.getMaxRows() 
+                    << " more\n";
+                break;
+            }
+            out << "Slot " << i << " --> " << hashTable.getKey(i).toString();
+            if (hashTable.getCount(i) > 1) {
+                out << " (x" << hashTable.getCount(i) << ")";
+            }
+            out << '\n';
+        }
+    } else {
+        out << "\nHash Table:\n";
+    }
+    
+    HashTableStats stats = hashTable.getStats();
+    out << "Entries: " << stats.entries << ", Slots: " << stats.capacity 
+        << ", Load: " << stats.loadFactor << ", Avg probe: " << stats.avgProbe 
+        << ", Max probe: " << stats.maxProbe << '\n';
+}
+
+/************************************************************
+*    Checks that a log record holds a game or code this 
+*    version of the program could have written.
+***********************************************************/
+static bool validRecord(const LogRecord& record) {
+    int length = record.codeLength;
+    int colors = record.numColors;
+    if (!validBoard(length, colors, record.duplicateSetting)) {
+        return false;
+    }
+    if (record.type == 'C' || record.type == 'G') {
+        Code code;
+        code.bits = record.value;
+        bool ok = code.size() == length;
+        for (int i = 0; i < length; i++) {
+            ok &= code.peg(i) < colors;
+        }
+        return ok;
+    }
+    int turns = static_cast<int>(record.value & 0xFF);
+    return record.type == 'R' && record.isWin <= 1 && (record.value >> 40) == 0 && 
+           turns >= 1 && turns <= turnLimit(length, colors);
+}
+
+/************************************************************
+*    Converts the complete, valid records of a version 1 log 
+*    (8 colors, 3-bit pegs) into `upgraded` and rewrites the 
+*    file in the current format. The new log is written and 
+*    synced to `<path>.tmp` first and then renamed over the 
+*    old one, so a crash part way through leaves the old log 
+*    intact. Returns false if the file could not be rewritten.
+***********************************************************/
+bool HistoryLog::upgrade(const char* path, const LogRecordV1* records, 
+                         size_t numRecords, vector<LogRecord>& upgraded) {
+    for (size_t i = 0; i < numRecords; i++) {
+        const LogRecordV1& old = records[i];
+        LogRecord record = {old.type, old.codeLength, 8, old.duplicateSetting, 
+                            old.isWin, {0, 0, 0}, old.value};
+        if (old.type == 'C') {
+            record.value = static_cast<uint64_t>(old.value >> 24) << 60;
+            for (int peg = 0; peg < old.codeLength && peg < 8; peg++) {
+                record.value |= static_cast<uint64_t>((old.value >> (3 * peg)) & 7) 
+                                << (4 * peg);
+            }
+            if ((old.value >> 24) != old.codeLength) {
+                break;
+            }
+        }
+        if (!validRecord(record)) {
+            break;
+        }
+        upgraded.push_back(record);
+    }
+    
+    string tempPath = string(path) + ".tmp";
+    int tempFd = ::open(tempPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (tempFd < 0) {
+        return false;
+    }
+    
+    LogHeader header = {{'M', 'M', 'H', 'L'}, version};
+    size_t bytes = upgraded.size() * sizeof(LogRecord);
+    if (write(tempFd, &header, sizeof(header)) != sizeof(header) || 
+        (bytes != 0 && write(tempFd, upgraded.data(), bytes) != ssize_t(bytes)) || 
+        fsync(tempFd) != 0 || rename(tempPath.c_str(), path) != 0) {
+        close(tempFd);
+        unlink(tempPath.c_str());
+        return false;
+    }
+    
+    // The renamed file is the log from now on
+    close(fd);
+    fd = tempFd;
+    return true;
+}
+
+/************************************************************
+*    Opens (or creates) the log at `path`, replays every 
+*    complete record into `results` and `hashTable` (and the 
+*    codes into `issued`, if given), and trims a truncated or 
+*    corrupt tail so new records are appended after the last 
+*    good one. Returns false if the file cannot be used; it 
+*    is then left untouched.
+***********************************************************/
+bool HistoryLog::open(const char* path, ResultsIndex& results, 
+                      HashTable& hashTable, IssuedCodes* issued) {
+    fd = ::open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        fd = -1;
+        return false;
+    }
+    size_t fileSize = static_cast<size_t>(info.st_size);
+    
+    // New file, or a header that was never completely written
+    if (fileSize < sizeof(LogHeader)) {
+        LogHeader header = {{'M', 'M', 'H', 'L'}, version};
+        if (ftruncate(fd, 0) != 0 || 
+            write(fd, &header, sizeof(header)) != sizeof(header)) {
+            close(fd);
+            fd = -1;
+            return false;
+        }
+        return true;
+    }
+    
+    void* mapping = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+        close(fd);
+        fd = -1;
+        return false;
+    }
+    const char* data = static_cast<const char*>(mapping);
+    
+    const LogHeader* header = reinterpret_cast<const LogHeader*>(data);
+    if (memcmp(header->magic, "MMHL", 4) != 0 || 
+        header->version < 1 || header->version > version) {
+        munmap(mapping, fileSize);
+        close(fd);
+        fd = -1;
+        return false;
+    }
+    
+    const LogRecord* records = 
+        reinterpret_cast<const LogRecord*>(data + sizeof(LogHeader));
+    size_t numRecords = (fileSize - sizeof(LogHeader)) / sizeof(LogRecord);
+    vector<LogRecord> upgraded;
+    if (header->version == 1) {
+        bool rewritten = upgrade(path, 
+            reinterpret_cast<const LogRecordV1*>(data + sizeof(LogHeader)), 
+            (fileSize - sizeof(LogHeader)) / sizeof(LogRecordV1), upgraded);
+        munmap(mapping, fileSize);
+        mapping = nullptr;
+        if (!rewritten) {
+            close(fd);
+            fd = -1;
+            return false;
+        }
+        records = upgraded.data();
+        numRecords = upgraded.size();
+    }
+    
+    // Replay complete records up to the first damaged one. A game's 
+    // guesses only count once its 'R' record is there too.
+    size_t good = 0;
+    vector<Code> guesses;
+    for (size_t i = 0; i < numRecords && validRecord(records[i]); i++) {
+        const LogRecord& record = records[i];
+        Code code;
+        code.bits = record.value;
+        if (record.type == 'C') {
+            hashTable.insert(code, boardIndex(record.codeLength, record.numColors, 
+                                              record.duplicateSetting));
+            if (issued != nullptr) {
+                issued->markIssued(code, record.numColors, record.duplicateSetting);
+            }
+            good = i + 1;
+        } else if (record.type == 'G') {
+            guesses.push_back(code);
+        } else {
+            GameResult gr(record.codeLength, record.numColors, 
+                          record.duplicateSetting, record.isWin != 0, 
+                          static_cast<int>(record.value & 0xFF), 
+                          static_cast<uint32_t>(record.value >> 8));
+            bool complete = guesses.size() == size_t(gr.turnsUsed);
+            results.insert(gr, complete ? guesses.data() : nullptr);
+            guesses.clear();
+            good = i + 1;
+        }
+    }
+    bool olderVersion = mapping != nullptr && header->version != version;
+    if (mapping != nullptr) {
+        munmap(mapping, fileSize);
+    }
+    
+    // A version 2 log is valid as it is, but an older program must 
+    // not append to it once it holds version 3 records
+    LogHeader current = {{'M', 'M', 'H', 'L'}, version};
+    size_t validSize = sizeof(LogHeader) + good * sizeof(LogRecord);
+    if ((olderVersion && 
+         pwrite(fd, &current, sizeof(current), 0) != sizeof(current)) || 
+        (validSize < fileSize && ftruncate(fd, validSize) != 0) || 
+        lseek(fd, 0, SEEK_END) < 0) {
+        close(fd);
+        fd = -1;
+        return false;
+    }
+    return true;
+}
+
+/************************************************************
+*    Fills `codes` with every code of the given length using 
+*    the first `colors` colors, in `codeRank` order 
+*    (the first peg changes fastest). Without duplicates the 
+*    colors still free are tried for each peg in turn, so 
+*    codes with repeated colors are never visited at all.
+***********************************************************/
+void enumerateCodes(int length, int colors, char choice, vector<Code>& codes) {
+    codes.clear();
+    codes.reserve(codeSpace(length, colors, choice));
+    Code code;
+    code.bits = static_cast<uint64_t>(length) << 60;
+    
+    if (tolower(choice) == 'y') {
+        uint64_t total = codeSpace(length, colors, 'y');
+        for (uint64_t n = 0; n < total; n++) {
+            codes.push_back(code);
+            // Add one to the first peg, carrying past the last color
+            for (int i = 0; i < length; i++) {
+                if (code.peg(i) + 1 < colors) {
+                    code.bits += 1ull << (4 * i);
+                    break;
+                }
+                code.bits &= ~(15ull << (4 * i));
+            }
+        }
+        return;
+    }
+    
+    // Walk from the last peg down to the first, like an odometer
+    int color[maxPegs];
+    unsigned used = 0;      // Colors held by the pegs above `pos`
+    int pos = length - 1;
+    color[pos] = -1;
+    while (pos < length) {
+        if (color[pos] >= 0) {
+            used &= ~(1u << color[pos]);
+        }
+        int next = color[pos] + 1;
+        while (next < colors && ((used >> next) & 1)) {
+            next++;
+        }
+        if (next == colors) {
+            pos++;      // Every color tried here; move on one peg up
+            continue;
+        }
+        color[pos] = next;
+        used |= 1u << next;
+        code.bits = (code.bits & ~(15ull << (4 * pos))) | 
+                    (static_cast<uint64_t>(next) << (4 * pos));
+        if (pos == 0) {
+            codes.push_back(code);
+        } else {
+            color[--pos] = -1;
+        }
+    }
+}
+
+/************************************************************
+*    Partitions the remaining candidates by the feedback they 
+*    would give to `guess` and ranks the partition for the 
+*    solver's strategy. Lower is better.
+***********************************************************/
+double Solver::evaluateGuess(const Code& guess, vector<Feedback>& scratch) const {
+    const size_t chunk = scratch.size();
+    uint32_t partition[(maxPegs + 1) * (maxPegs + 1)] = {0}; // Feedback classes
+    
+    for (size_t start = 0; start < candidates.size(); start += chunk) {
+        size_t n = min(chunk, candidates.size() - start);
+        engine->scoreBatch(guess, candidates.data() + start, n, scratch.data());
+        for (size_t i = 0; i < n; i++) {
+            partition[scratch[i].black * (length + 1) + scratch[i].white]++;
+        }
+    }
+    
+    double score = 0;
+    for (uint32_t size : partition) {
+        if (size == 0) {
+            continue;
+        }
+        if (strategy == MINIMAX) {
+            score = max(score, static_cast<double>(size));
+        } else if (strategy == EXPECTED_SIZE) {
+            score += static_cast<double>(size) * size;
+        } else {
+            score += size * log2(static_cast<double>(size));
+        }
+    }
+    return score;
+}
+
+/************************************************************
+*    Chooses the next guess. Candidates are tried in a 
+*    scattered order so that a move cut short by the time 
+*    budget still samples the whole candidate space; each 
+*    worker evaluates at least one guess.
+***********************************************************/
+Code Solver::nextGuess() const {
+    const size_t n = candidates.size();
+    if (n <= 2 || strategy == FIRST_CONSISTENT) {
+        return candidates.front();
+    }
+    
+    Code known;
+    if (bookSlot >= 0 && book->lookup(board, strategy, bookSlot, known)) {
+        return known;
+    }
+    
+    // A stride coprime with n visits every index exactly once
+    size_t stride = n / 2 + n / 8 + 1;
+    while (gcd(stride, n) != 1) {
+        stride++;
+    }
+    
+    auto deadline = chrono::steady_clock::now() + 
+                    chrono::duration<double>(timeBudget);
+    atomic<size_t> nextIndex(0);
+    int workers = (n < 4096) ? 1 : numThreads;
+    vector<double> bestScore(workers, HUGE_VAL);
+    vector<size_t> bestIndex(workers, n);
+    
+    auto work = [&](int id) {
+        vector<Feedback> scratch(4096);
+        bool first = true;
+        for (size_t i = nextIndex++; i < n; i = nextIndex++) {
+            if (!first && chrono::steady_clock::now() > deadline) {
+                break;
+            }
+            first = false;
+            
+            size_t index = (i * stride) % n;
+            double score = evaluateGuess(candidates[index], scratch);
+            if (score < bestScore[id] || 
+                (score == bestScore[id] && index < bestIndex[id])) {
+                bestScore[id] = score;
+                bestIndex[id] = index;
+            }
+        }
+    };
+    
+    vector<thread> pool;
+    for (int id = 1; id < workers; id++) {
+        pool.emplace_back(work, id);
+    }
+    work(0);
+    for (thread& t : pool) {
+        t.join();
+    }
+    
+    int best = 0;
+    for (int id = 1; id < workers; id++) {
+        if (bestScore[id] < bestScore[best] || 
+            (bestScore[id] == bestScore[best] && bestIndex[id] < bestIndex[best])) {
+            best = id;
+        }
+    }
+    return candidates[bestIndex[best]];
+}
+
+/************************************************************
+*    The guess among `guesses` whose partition of the 
+*    candidates is best, the first one on ties. Every guess 
+*    is evaluated in full, whatever the time budget.
+***********************************************************/
+Code Solver::bestOf(const vector<Code>& guesses) const {
+    vector<Feedback> scratch(4096);
+    size_t best = 0;
+    double bestScore = HUGE_VAL;
+    for (size_t i = 0; i < guesses.size(); i++) {
+        double score = evaluateGuess(guesses[i], scratch);
+        if (score < bestScore) {
+            bestScore = score;
+            best = i;
+        }
+    }
+    return guesses[best];
+}
+
+/************************************************************
+*    Removes every candidate that would not have produced 
+*    the feedback `fb` for `guess`. Large candidate sets are 
+*    filtered in slices, one per core. The book is followed 
+*    for the reply only if the book's first guess was played.
+***********************************************************/
+void Solver::update(const Code& guess, const Feedback& fb) {
+    Code known;
+    if (bookSlot == 0 && book->lookup(board, strategy, 0, known) && 
+        known == guess) {
+        bookSlot = OpeningBook::replySlot(length, fb);
+    } else {
+        bookSlot = -1;
+    }
+    
+    const size_t n = candidates.size();
+    int workers = (n < 65536) ? 1 : numThreads;
+    size_t slice = (n + workers - 1) / workers;
+    vector<size_t> kept(workers, 0);
+    
+    // Each slice is compacted in place, then the slices are joined
+    auto work = [&](int id) {
+        size_t begin = min(n, id * slice);
+        size_t end = min(n, begin + slice);
+        size_t out = begin;
+        for (size_t i = begin; i < end; i++) {
+            if (engine->score(guess, candidates[i]) == fb) {
+                candidates[out++] = candidates[i];
+            }
+        }
+        kept[id] = out - begin;
+    };
+    
+    vector<thread> pool;
+    for (int id = 1; id < workers; id++) {
+        pool.emplace_back(work, id);
+    }
+    work(0);
+    for (thread& t : pool) {
+        t.join();
+    }
+    
+    size_t total = kept[0];
+    for (int id = 1; id < workers; id++) {
+        size_t begin = id * slice;
+        copy(candidates.begin() + begin, candidates.begin() + begin + kept[id], 
+             candidates.begin() + total);
+        total += kept[id];
+    }
+    candidates.resize(total);
+}
+
+/************************************************************
+*    Starts tracking a new game: every code of the board is 
+*    possible. Returns false, tracking nothing, if the board 
+*    has too many codes.
+***********************************************************/
+bool CandidateSet::reset(int length, int colors, char choiceDuplicate) {
+    if (!canTrack(length, colors)) {
+        words.clear();
+        count = 0;
+        this->length = 0;
+        return false;
+    }
+    this->length = length;
+    this->colors = colors;
+    
+    uint64_t numCodes = codeSpace(length, colors, 'y');
+    size_t numWords = (numCodes + 63) / 64;
+    if (tolower(choiceDuplicate) == 'y') {
+        words.assign(numWords, ~0ull);
+        if (numCodes % 64 != 0) {
+            words.back() = ~0ull >> (64 - numCodes % 64);   // Not past the last code
+        }
+        count = numCodes;
+    } else {
+        // The codes without repeated colors are worked out once per board
+        if (distinctLength != length || distinctColors != colors) {
+            vector<Code> valid;
+            enumerateCodes(length, colors, choiceDuplicate, valid);
+            distinctWords.assign(numWords, 0);
+            for (const Code& code : valid) {
+                uint64_t index = codeRank(code, colors);
+                distinctWords[index / 64] |= 1ull << (index % 64);
+            }
+            distinctLength = length;
+            distinctColors = colors;
+            distinctCount = valid.size();
+        }
+        words.assign(distinctWords.begin(), distinctWords.end());
+        count = distinctCount;
+    }
+    return true;
+}
+
+/************************************************************
+*    Keeps only the codes that would have given feedback `fb` 
+*    to `guess`. A code of rank r is split into its first 
+*    `lowPegs` pegs (rank r % lowCodes) and the rest (rank 
+*    r / lowCodes): its blacks are the sum of both parts' 
+*    and its color counts the sum of both parts' nibbles.
+***********************************************************/
+void CandidateSet::update(const Code& guess, const Feedback& fb) {
+    if (length == 0) {
+        return;
+    }
+    
+    // Table every choice of the first pegs against the guess
+    int lowPegs = 0;
+    uint64_t lowCodes = 1;
+    while (lowPegs + 1 < length && lowCodes * colors <= maxLowCodes) {
+        lowPegs++;
+        lowCodes *= colors;
+    }
+    lowBlack.resize(lowCodes);
+    lowCounts.resize(lowCodes);
+    for (uint64_t j = 0; j < lowCodes; j++) {
+        uint64_t rest = j;
+        int black = 0;
+        uint64_t counts = 0;
+        for (int i = 0; i < lowPegs; i++) {
+            int peg = static_cast<int>(rest % colors);
+            rest /= colors;
+            black += (peg == guess.peg(i));
+            counts += 1ull << (4 * peg);
+        }
+        lowBlack[j] = static_cast<uint8_t>(black);
+        lowCounts[j] = counts;
+    }
+    
+    const uint64_t guessCounts = colorCounts(guess);
+    const int wantBlack = fb.black;
+    const int wantCommon = fb.black + fb.white;
+    const bool smallCounts = length < 8;
+    const size_t numWords = words.size();
+    int workers = (count < 65536) ? 1 : numThreads;
+    size_t slice = (numWords + workers - 1) / workers;
+    
+    auto work = [&](int id) {
+        size_t begin = min(numWords, id * slice);
+        size_t end = min(numWords, begin + slice);
+        uint64_t highBase = 0;      // Rank of the first code sharing the high pegs
+        int highBlack = 0;
+        uint64_t highCounts = 0;
+        
+        // Score the pegs past the first ones for the high part of `index`
+        auto enterHigh = [&](uint64_t index) {
+            uint64_t rest = index / lowCodes;
+            highBase = rest * lowCodes;
+            highBlack = 0;
+            highCounts = 0;
+            for (int i = lowPegs; i < length; i++) {
+                int peg = static_cast<int>(rest % colors);
+                rest /= colors;
+                highBlack += (peg == guess.peg(i));
+                highCounts += 1ull << (4 * peg);
+            }
+        };
+        enterHigh(begin * 64);
+        
+        uint64_t total = 0;
+        for (size_t w = begin; w < end; w++) {
+            uint64_t bits = words[w];
+            if (bits == 0) {
+                continue;
+            }
+            uint64_t keep = 0;
+            for (uint64_t rest = bits; rest != 0; rest &= rest - 1) {
+                int bit = __builtin_ctzll(rest);
+                uint64_t index = w * 64 + bit;
+                if (index - highBase >= lowCodes) {
+                    enterHigh(index);
+                }
+                uint64_t low = index - highBase;
+                int black = lowBlack[low] + highBlack;
+                int common = commonColors(guessCounts, lowCounts[low] + highCounts, 
+                                          smallCounts);
+                keep |= static_cast<uint64_t>(black == wantBlack && 
+                                              common == wantCommon) << bit;
+            }
+            words[w] = keep;
+            total += __builtin_popcountll(keep);
+        }
+        kept[id] = total;
+    };
+    
+    if (workers == 1) {
+        work(0);
+    } else {
+        runRound([](void* context, int id) {
+            (*static_cast<decltype(work)*>(context))(id);
+        }, &work);
+    }
+    count = accumulate(kept.begin(), kept.begin() + workers, 0ull);
+}
+
+/************************************************************
+*    Runs `work(context, id)` on every member of the team, 
+*    with the calling thread as worker 0, and returns once 
+*    all of them are done. The team is started on first use.
+***********************************************************/
+void CandidateSet::runRound(void (*work)(void*, int), void* context) {
+    if (team.empty()) {
+        team.reserve(numThreads - 1);
+        for (int id = 1; id < numThreads; id++) {
+            team.emplace_back(&CandidateSet::runTeam, this, id);
+        }
+    }
+    {
+        lock_guard<mutex> guard(teamLock);
+        job = work;
+        jobContext = context;
+        busy = numThreads - 1;
+        round++;
+    }
+    wake.notify_all();
+    work(context, 0);
+    unique_lock<mutex> guard(teamLock);
+    finished.wait(guard, [this]() { return busy == 0; });
+}
+
+// Loop of team member `id`: run each round's work until stopped
+void CandidateSet::runTeam(int id) {
+    uint64_t seen = 0;
+    unique_lock<mutex> guard(teamLock);
+    while (true) {
+        wake.wait(guard, [&]() { return stopping || round != seen; });
+        if (stopping) {
+            return;
+        }
+        seen = round;
+        guard.unlock();
+        job(jobContext, id);
+        guard.lock();
+        if (--busy == 0) {
+            finished.notify_one();
+        }
+    }
+}
+
+/************************************************************
+*    Runs many games without any interaction, for load and 
+*    regression testing:
+*      --batch <games> <length> <y|n> <seed> <strategy> [budget]
+*              [--colors <n>] [--unique] [--book <file>]
+*    where strategy is minimax, expected, entropy or first, 
+*    budget is the solver's seconds per move and n the number 
+*    of colors (8 by default). With --unique no secret code 
+*    is used twice, and the run stops early once every code 
+*    has been played. With --book the solver's first two 
+*    moves come from an opening book. Every game goes 
+*    through genCode, compareGuess and recordResult with the 
+*    per-turn output turned off. Reports throughput, per-game 
+*    latency percentiles and a win-rate table by turns used.
+***********************************************************/
+int runBatch(int argc, char* argv[]) {
+    IssuedCodes issuedCodes;
+    IssuedCodes* issued = nullptr;
+    int colors = 8;
+    OpeningBook openingBook;
+    const char* bookFile = nullptr;
+    
+    // Take out the options; the settings are the remaining arguments
+    vector<char*> args;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--unique") == 0) {
+            issued = &issuedCodes;
+        } else if (strcmp(argv[i], "--colors") == 0 && i + 1 < argc) {
+            colors = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--book") == 0 && i + 1 < argc) {
+            bookFile = argv[++i];
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+    argc = static_cast<int>(args.size());
+    argv = args.data();
+    
+    if (argc < 7) {
+        cerr << "Usage: " << argv[0] << " --batch <games> <length> <y|n> "
+                "<seed> <minimax|expected|entropy|first> [budget] "
+                "[--colors <n>] [--unique] [--book <file>]" << endl;
+        return 1;
+    }
+    if (bookFile != nullptr && !openingBook.load(bookFile)) {
+        cerr << "Error: " << bookFile << " is not a valid opening book." << endl;
+        return 1;
+    }
+    
+    long games = atol(argv[2]);
+    int length = atoi(argv[3]);
+    char choiceDuplicate = tolower(argv[4][0]);
+    unsigned int seed = static_cast<unsigned int>(strtoul(argv[5], nullptr, 10));
+    int strategy = strategyByName(argv[6]);
+    double budget = (argc > 7) ? atof(argv[7]) : 0.1;
+    
+    if (games <= 0 || !validBoard(length, colors, choiceDuplicate) || 
+        strategy == 0 || budget <= 0) {
+        cerr << "Error: invalid batch settings." << endl;
+        return 1;
+    }
+    if (!Solver::canSolve(length, colors, choiceDuplicate)) {
+        cerr << "Error: the board has more than " << Solver::maxCodes 
+             << " codes, too many for the solver." << endl;
+        return 1;
+    }
+    
+    ResultsIndex results;
+    HashTable hashTable(8);
+    vector<double> latencies;      // Microseconds per game
+    int turns = turnLimit(length, colors);
+    vector<long> turnsUsed(turns + 1, 0); // Index 0 counts losses
+    GameSession session;
+    GameTrace trace;
+    
+    latencies.reserve(games);
+    setupGame(seed);
+    
+    auto batchStart = chrono::steady_clock::now();
+    for (long game = 0; game < games; game++) {
+        auto gameStart = chrono::steady_clock::now();
+        
+        if (!session.start(length, colors, choiceDuplicate, codeGenerator, 
+                           issued)) {
+            cout << "Every code was played after " << game << " games." << endl;
+            games = game;
+            break;
+        }
+        hashTable.insert(session.getCode(), 
+                         boardIndex(length, colors, choiceDuplicate));
+        results.reserve(length, colors, choiceDuplicate);
+        trace.begin();
+        
+        Solver solver(length, colors, choiceDuplicate, 
+                      static_cast<SolverStrategy>(strategy), budget, &openingBook);
+        while (session.isPlaying()) {
+            Code solverGuess = solver.nextGuess();
+            compareGuess(session, solverGuess.toString(), results, false, nullptr, 
+                         &trace);
+            solver.update(solverGuess, scoreGuess(solverGuess, session.getCode()));
+        }
+        turnsUsed[session.isWon() ? session.getTurnsUsed() : 0]++;
+        
+        latencies.push_back(chrono::duration<double, micro>(
+                            chrono::steady_clock::now() - gameStart).count());
+    }
+    double seconds = chrono::duration<double>(
+                     chrono::steady_clock::now() - batchStart).count();
+    
+    sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) {
+        return latencies[static_cast<size_t>(p * (latencies.size() - 1))];
+    };
+    
+    cout << "Games: " << games << ", Length: " << length << ", Colors: " << colors 
+         << ", Duplicates: " << choiceDuplicate << ", Seed: " << seed 
+         << ", Strategy: " << strategyNames[strategy] << endl;
+    cout << "Elapsed: " << seconds << " s, Throughput: " 
+         << games / seconds << " games/sec" << endl;
+    cout << "Latency per game (us): p50 " << percentile(0.50) 
+         << ", p90 " << percentile(0.90) << ", p99 " << percentile(0.99) 
+         << ", max " << latencies.back() << endl;
+    
+    cout << "\nTurns  Games  Percent" << endl;
+    for (int t = 1; t <= turns; t++) {
+        cout << t << "\t" << turnsUsed[t] << "\t" 
+             << 100.0 * turnsUsed[t] / games << "%" << endl;
+    }
+    cout << "Lost\t" << turnsUsed[0] << "\t" 
+         << 100.0 * turnsUsed[0] / games << "%" << endl;
+    cout << "Win rate: " << 100.0 * (games - turnsUsed[0]) / games << "%" << endl;
+    cout << "History memory: " << results.getArena().bytesInUse() 
+         << " bytes in use, " << results.getArena().bytesReserved() 
+         << " bytes reserved, " << results.getHistory().bytesInUse() 
+         << " bytes of columns" << endl;
+    
+    return 0;
+}
+
+/************************************************************
+*    A whole file mapped read-only into memory, unmapped when 
+*    the object goes away. An empty file gives an empty view.
+***********************************************************/
+class MappedFile {
+private:
+    void* mapping;
+    size_t size;
+
+public:
+    // Constructor
+    MappedFile() {
+        mapping = nullptr;
+        size = 0;
+    }
+    
+    ~MappedFile() {
+        if (mapping != nullptr) {
+            munmap(mapping, size);
+        }
+    }
+    
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    
+    // Map the file at `path`; returns false if it cannot be read
+    bool open(const char* path) {
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info;
+        bool ok = fstat(fd, &info) == 0;
+        if (ok && info.st_size > 0) {
+            size = static_cast<size_t>(info.st_size);
+            mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED) {
+                mapping = nullptr;
+                size = 0;
+                ok = false;
+            } else {
+                madvise(mapping, size, MADV_SEQUENTIAL);
+            }
+        }
+        close(fd);  // The mapping stays valid without the descriptor
+        return ok;
+    }
+    
+    string_view view() const {
+        return string_view(static_cast<const char*>(mapping), size);
+    }
+};
+
+// Removes and returns the first space-separated word of `text`
+static string_view nextWord(string_view& text) {
+    size_t start = text.find_first_not_of(" \t");
+    if (start == string_view::npos) {
+        text = string_view();
+        return text;
+    }
+    size_t end = min(text.find_first_of(" \t", start), text.size());
+    string_view word = text.substr(start, end - start);
+    text.remove_prefix(end);
+    return word;
+}
+
+// Parses all of `word` as a decimal number; false if it is not one
+template <typename T>
+static bool parseNumber(string_view word, T& value) {
+    const char* end = word.data() + word.size();
+    from_chars_result result = from_chars(word.data(), end, value);
+    return !word.empty() && result.ec == errc() && result.ptr == end;
+}
+
+/************************************************************
+*    Replays a script of recorded games and writes a 
+*    transcript of every turn that can be diffed against a 
+*    golden run, or checked against one in place:
+*    
+*      mastermind --replay <script> [golden]
+*    
+*    The script is read straight from a memory map and split 
+*    into lines and words as string_views, without copies. 
+*    Blank lines and lines starting with '#' are skipped; 
+*    every game starts with a settings line, and each of the 
+*    following lines is one guess:
+*    
+*      game <length> <colors> <y|n> <seed>
+*      1234
+*    
+*    Secret codes come from the seed alone, so a script 
+*    always replays the same games. Bad lines are reported 
+*    by number in the transcript and the replay goes on. The 
+*    transcript uses the server's words:
+*    
+*      GAME <number> <length> <colors> <y|n> <seed> <turns>
+*      HINT <guess> <hint> <turns left>
+*      WIN <turns> / LOSE <code> / UNFINISHED <turns> <code>
+*      ERROR <line> <message>
+*    
+*    With a golden transcript nothing is printed; the run 
+*    reports the first line that differs and fails if any 
+*    does. Counts and timings go to stderr either way.
+***********************************************************/
+int runReplay(int argc, char* argv[]) {
+    if (argc < 3 || argc > 4) {
+        cerr << "Usage: " << argv[0] << " --replay <script> [golden]" << endl;
+        return 1;
+    }
+    
+    MappedFile script;
+    MappedFile golden;
+    if (!script.open(argv[2])) {
+        cerr << "Error: cannot read " << argv[2] << endl;
+        return 1;
+    }
+    if (argc > 3 && !golden.open(argv[3])) {
+        cerr << "Error: cannot read " << argv[3] << endl;
+        return 1;
+    }
+    bool checking = argc > 3;
+    string_view expected = golden.view();
+    
+    // The transcript is built in one buffer and written or checked in blocks
+    const size_t blockSize = 1 << 16;
+    string transcript;
+    transcript.reserve(blockSize + 256);
+    size_t done = 0;                // Transcript bytes already written or checked
+    size_t firstDifference = string_view::npos;
+    
+    auto flushTranscript = [&]() {
+        if (!checking) {
+            cout.write(transcript.data(), transcript.size());
+        } else if (firstDifference == string_view::npos) {
+            string_view rest = expected.substr(min(done, expected.size()));
+            size_t common = min(rest.size(), transcript.size());
+            size_t same = mismatch(transcript.begin(), transcript.begin() + common, 
+                                   rest.begin()).first - transcript.begin();
+            if (same < transcript.size()) {
+                firstDifference = done + same;
+            }
+        }
+        done += transcript.size();
+        transcript.clear();
+    };
+    
+    char digits[24];
+    auto appendNumber = [&](uint64_t value) {
+        to_chars_result result = to_chars(digits, digits + sizeof(digits), value);
+        transcript.append(digits, result.ptr - digits);
+    };
+    
+    GameSession session;
+    GameTrace trace;
+    CodeGenerator generator;
+    ResultsIndex results;
+    long games = 0, guesses = 0, rejected = 0;
+    
+    // Notes a game the script left before it was over
+    auto endUnfinished = [&]() {
+        if (session.isPlaying()) {
+            transcript += "UNFINISHED ";
+            appendNumber(session.getTurnsUsed());
+            transcript += ' ';
+            transcript += session.getCode().toString();
+            transcript += '\n';
+        }
+    };
+    
+    auto startTime = chrono::steady_clock::now();
+    string_view text = script.view();
+    uint64_t lineNumber = 0;
+    while (!text.empty()) {
+        size_t end = min(text.find('\n'), text.size());
+        string_view line = text.substr(0, end);
+        text.remove_prefix(min(end + 1, text.size()));
+        lineNumber++;
+        
+        // Trim the line; skip it if blank or a comment
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == string_view::npos || line[first] == '#') {
+            continue;
+        }
+        line = line.substr(first, line.find_last_not_of(" \t\r") + 1 - first);
+        
+        string_view rest = line;
+        if (nextWord(rest) == "game") {
+            endUnfinished();
+            int length = 0, colors = 0;
+            uint64_t seed = 0;
+            bool ok = parseNumber(nextWord(rest), length) && 
+                      parseNumber(nextWord(rest), colors);
+            string_view duplicates = nextWord(rest);
+            ok = ok && duplicates.size() == 1 && parseNumber(nextWord(rest), seed) && 
+                 rest.find_first_not_of(" \t") == string_view::npos;
+            char choiceDuplicate = ok ? tolower(duplicates[0]) : '\0';
+            if (!ok || !validBoard(length, colors, choiceDuplicate)) {
+                transcript += "ERROR ";
+                appendNumber(lineNumber);
+                transcript += " Invalid settings. Use game <1-15> <2-16> <y|n> <seed>.\n";
+                session = GameSession();
+                rejected++;
+                continue;
+            }
+            
+            generator.setSeed(seed);
+            session.start(length, colors, choiceDuplicate, generator);
+            results.reserve(length, colors, choiceDuplicate);
+            trace.begin();
+            games++;
+            transcript += "GAME ";
+            appendNumber(games);
+            transcript += ' ';
+            appendNumber(length);
+            transcript += ' ';
+            appendNumber(colors);
+            transcript += ' ';
+            transcript += choiceDuplicate;
+            transcript += ' ';
+            appendNumber(seed);
+            transcript += ' ';
+            appendNumber(session.getTurnLimit());
+            transcript += '\n';
+        } else {
+            guesses++;
+            InputError error = session.isPlaying() ? 
+                checkGuess(line, session.getLength(), session.getColors()) : 
+                INPUT_OK;
+            if (!session.isPlaying() || error != INPUT_OK) {
+                transcript += "ERROR ";
+                appendNumber(lineNumber);
+                transcript += ' ';
+                if (!session.isPlaying()) {
+                    transcript += "No game in progress.";
+                } else {
+                    appendInputError(transcript, error, session.getColors());
+                }
+                transcript += '\n';
+                rejected++;
+                continue;
+            }
+            
+            Code guess = Code::fromString(line);
+            Feedback fb = session.submit(guess);
+            trace.guesses.push_back(guess);
+            transcript += "HINT ";
+            transcript += line;
+            transcript += ' ';
+            transcript += session.hintText(fb);
+            transcript += ' ';
+            appendNumber(session.getTurnsLeft());
+            transcript += '\n';
+            if (session.isWon()) {
+                transcript += "WIN ";
+                appendNumber(session.getTurnsUsed());
+                transcript += '\n';
+            } else if (session.isOver()) {
+                transcript += "LOSE ";
+                transcript += session.getCode().toString();
+                transcript += '\n';
+            }
+            if (session.isOver()) {
+                recordResult(session.getLength(), session.getColors(), 
+                             session.getDuplicateChoice(), session.isWon(), 
+                             session.getTurnsUsed(), results, &trace);
+            }
+        }
+        
+        if (transcript.size() >= blockSize) {
+            flushTranscript();
+        }
+    }
+    endUnfinished();
+    flushTranscript();
+    cout.flush();
+    double seconds = chrono::duration<double>(
+                     chrono::steady_clock::now() - startTime).count();
+    
+    long wins = 0;
+    for (int board = 0; board < numBoards; board++) {
+        wins += results.getStats(board).wins;
+    }
+    cerr << "Replayed " << games << " games (" << wins << " won, " 
+         << results.size() - wins << " lost) and " << guesses << " guesses from " 
+         << lineNumber << " lines, " << rejected << " rejected, in " 
+         << seconds * 1000 << " ms (" << lineNumber / seconds << " lines/sec)" 
+         << endl;
+    
+    if (checking) {
+        // A golden transcript that goes on after ours also differs
+        if (firstDifference == string_view::npos && done < expected.size()) {
+            firstDifference = done;
+        }
+        if (firstDifference != string_view::npos) {
+            size_t at = min(firstDifference, expected.size());
+            cerr << "Transcript differs from " << argv[3] << " at line " 
+                 << count(expected.begin(), expected.begin() + at, '\n') + 1 
+                 << endl;
+            return 1;
+        }
+        cerr << "Transcript matches " << argv[3] << endl;
+    }
+    return 0;
+}
+
+/************************************************************
+*    Reads a game-history log without changing it and prints 
+*    the aggregates of every board setting played in it:
+*      --report [history file]
+*    The log (Mastermind_History.dat by default) is replayed 
+*    straight into a GameHistory, leaving out the tree and 
+*    hash table the game keeps, so logs of tens of millions 
+*    of games load in seconds and report in milliseconds. 
+*    Version 1 logs have to be opened by the game once first.
+***********************************************************/
+int runReport(int argc, char* argv[]) {
+    if (argc > 3) {
+        cerr << "Usage: " << argv[0] << " --report [history file]" << endl;
+        return 1;
+    }
+    const char* path = (argc > 2) ? argv[2] : "Mastermind_History.dat";
+    
+    auto loadStart = chrono::steady_clock::now();
+    MappedFile file;
+    if (!file.open(path)) {
+        cerr << "Error: cannot read " << path << endl;
+        return 1;
+    }
+    string_view data = file.view();
+    const LogHeader* header = reinterpret_cast<const LogHeader*>(data.data());
+    if (data.size() < sizeof(LogHeader) || memcmp(header->magic, "MMHL", 4) != 0 || 
+        header->version < 2 || header->version > 3) {
+        cerr << "Error: " << path << " is not a game-history log this version "
+                "can report on." << endl;
+        return 1;
+    }
+    
+    // Replay complete games up to the first damaged record
+    const LogRecord* records = 
+        reinterpret_cast<const LogRecord*>(data.data() + sizeof(LogHeader));
+    size_t numRecords = (data.size() - sizeof(LogHeader)) / sizeof(LogRecord);
+    GameHistory history;
+    vector<Code> guesses;
+    for (size_t i = 0; i < numRecords && validRecord(records[i]); i++) {
+        const LogRecord& record = records[i];
+        if (record.type == 'G') {
+            Code guess;
+            guess.bits = record.value;
+            guesses.push_back(guess);
+        } else if (record.type == 'R') {
+            int turns = static_cast<int>(record.value & 0xFF);
+            bool complete = guesses.size() == size_t(turns);
+            history.append(boardIndex(record.codeLength, record.numColors, 
+                                      record.duplicateSetting), 
+                           record.isWin != 0, turns, 
+                           static_cast<uint32_t>(record.value >> 8), 
+                           guesses.data(), complete ? turns : 0);
+            guesses.clear();
+        }
+    }
+    double loadMs = chrono::duration<double, milli>(
+                    chrono::steady_clock::now() - loadStart).count();
+    
+    auto queryStart = chrono::steady_clock::now();
+    ostringstream report;
+    printHistoryReport(history, report);
+    double queryMs = chrono::duration<double, milli>(
+                     chrono::steady_clock::now() - queryStart).count();
+    
+    cout << report.str();
+    cout << "Loaded " << history.size() << " games from " << path << " in " 
+         << loadMs << " ms; report built in " << queryMs << " ms (" 
+         << history.bytesInUse() << " bytes of columns)" << endl;
+    return 0;
+}
+
+/************************************************************
+*    Adds the entries of a book written by `save`. Returns 
+*    false if the file cannot be read or an entry does not 
+*    fit its board; the book may then be partly filled.
+***********************************************************/
+bool OpeningBook::load(const char* path) {
+    MappedFile file;
+    if (!file.open(path)) {
+        return false;
+    }
+    string_view data = file.view();
+    if (data.size() < sizeof(BookHeader)) {
+        return false;
+    }
+    BookHeader header;
+    memcpy(&header, data.data(), sizeof(header));
+    if (memcmp(header.magic, "MMOB", 4) != 0 || header.version != version || 
+        data.size() != sizeof(BookHeader) + 
+                       static_cast<size_t>(header.numEntries) * sizeof(BookEntry)) {
+        return false;
+    }
+    
+    vector<BookEntry> entries(header.numEntries);
+    memcpy(entries.data(), data.data() + sizeof(BookHeader), 
+           entries.size() * sizeof(BookEntry));
+    for (const BookEntry& entry : entries) {
+        Code guess;
+        guess.bits = entry.guess;
+        int length = guess.size();
+        if (entry.board >= numBoards || entry.strategy < MINIMAX || 
+            entry.strategy >= numStrategies || length < 1 || 
+            entry.board / (2 * maxColors) != length - 1 || 
+            entry.slot >= 1 + (length + 1) * (length + 1)) {
+            return false;
+        }
+        int colors = (entry.board / 2) % maxColors + 1;
+        char choiceDuplicate = (entry.board % 2) ? 'y' : 'n';
+        if (!selectEngine(length, choiceDuplicate).valid(guess.toString(), colors)) {
+            return false;
+        }
+        add(entry.board, entry.strategy, entry.slot, guess);
+    }
+    return true;
+}
+
+/************************************************************
+*    Writes every entry of the book to `path`.
+***********************************************************/
+bool OpeningBook::save(const char* path) const {
+    vector<BookEntry> entries;
+    for (int key = 0; key < numBoards * numStrategies; key++) {
+        if (tables[key] < 0) {
+            continue;
+        }
+        for (int slot = 0; slot < numSlots; slot++) {
+            const Code& guess = guesses[tables[key] + slot];
+            if (guess.bits != 0) {
+                BookEntry entry = {static_cast<uint16_t>(key / numStrategies), 
+                                   static_cast<uint8_t>(key % numStrategies), 
+                                   static_cast<uint8_t>(slot), {0, 0, 0, 0}, 
+                                   guess.bits};
+                entries.push_back(entry);
+            }
+        }
+    }
+    
+    BookHeader header = {{'M', 'M', 'O', 'B'}, version, 
+                         static_cast<uint32_t>(entries.size()), 0};
+    ofstream file(path, ios::binary | ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(entries.data()), 
+               entries.size() * sizeof(BookEntry));
+    return static_cast<bool>(file);
+}
+
+/************************************************************
+*    Adds to `patterns` one code for every way of splitting 
+*    `left` more pegs into runs of one color each, no run 
+*    longer than `maxRun` and no more than `colors` colors 
+*    in all (e.g. 11122334). Renaming colors or moving pegs 
+*    does not change how a first guess splits the codes, so 
+*    these are the only first guesses worth comparing.
+***********************************************************/
+static void addFirstGuesses(int left, int maxRun, int colors, Code& prefix, 
+                            vector<Code>& patterns) {
+    if (left == 0) {
+        patterns.push_back(prefix);
+        return;
+    }
+    int color = (prefix.size() == 0) ? 0 : prefix.peg(prefix.size() - 1) + 1;
+    if (color >= colors) {
+        return;
+    }
+    for (int run = min(left, maxRun); run >= 1; run--) {
+        Code code = prefix;
+        for (int i = 0; i < run; i++) {
+            code.push_back(Code::symbol(color));
+        }
+        addFirstGuesses(left - run, run, colors, code, patterns);
+    }
+}
+
+/************************************************************
+*    Builds the opening book for the classic boards (4, 6 
+*    and 8 pegs of 8 colors, with and without duplicates) 
+*    and every strategy that ranks guesses:
+*      --build-book <file> [budget]
+*    The first guess is the best of one code per color 
+*    pattern, evaluated in full. The reply to each possible 
+*    first hint is the solver's own choice with `budget` 
+*    seconds to think (10 by default), which covers every 
+*    candidate on the 4- and 6-peg boards.
+***********************************************************/
+int runBuildBook(int argc, char* argv[]) {
+    if (argc < 3 || argc > 4) {
+        cerr << "Usage: " << argv[0] << " --build-book <file> [budget]" << endl;
+        return 1;
+    }
+    double budget = (argc > 3) ? atof(argv[3]) : 10.0;
+    if (budget <= 0) {
+        cerr << "Error: the budget must be a positive number of seconds." << endl;
+        return 1;
+    }
+    
+    OpeningBook book;
+    const int colors = 8;
+    for (int length : {4, 6, 8}) {
+        for (char choiceDuplicate : {'y', 'n'}) {
+            vector<Code> firstGuesses;
+            Code empty;
+            addFirstGuesses(length, (choiceDuplicate == 'y') ? length : 1, colors, 
+                            empty, firstGuesses);
+            
+            for (int strategy = MINIMAX; strategy <= MAX_ENTROPY; strategy++) {
+                auto start = chrono::steady_clock::now();
+                int board = boardIndex(length, colors, choiceDuplicate);
+                Solver solver(length, colors, choiceDuplicate, 
+                              static_cast<SolverStrategy>(strategy), budget);
+                Code opening = solver.bestOf(firstGuesses);
+                book.add(board, strategy, 0, opening);
+                
+                int replies = 0;
+                for (int black = 0; black < length; black++) {
+                    for (int white = 0; black + white <= length; white++) {
+                        Feedback fb;
+                        fb.black = static_cast<uint8_t>(black);
+                        fb.white = static_cast<uint8_t>(white);
+                        Solver next = solver;
+                        next.update(opening, fb);
+                        if (next.remaining() == 0) {
+                            continue;   // No code gives this hint
+                        }
+                        book.add(board, strategy, OpeningBook::replySlot(length, fb), 
+                                 next.nextGuess());
+                        replies++;
+                    }
+                }
+                
+                cout << "Length " << length << ", duplicates " << choiceDuplicate 
+                     << ", " << strategyNames[strategy] << ": opens with " 
+                     << opening.toString() << ", " << replies << " replies, " 
+                     << chrono::duration<double>(
+                            chrono::steady_clock::now() - start).count() 
+                     << " s" << endl;
+            }
+        }
+    }
+    
+    if (!book.save(argv[2])) {
+        cerr << "Error: cannot write " << argv[2] << endl;
+        return 1;
+    }
+    cout << "Wrote " << book.size() << " entries to " << argv[2] << endl;
+    return 0;
+}
+
+/************************************************************
+*    A pool of threads that run tasks which may spawn more 
+*    tasks. Each worker keeps its own queue and works on its 
+*    newest task first, which keeps the tasks in flight few; 
+*    a worker whose queue is empty steals the oldest task of 
+*    another queue, usually the largest piece of work left. 
+*    `run` returns once every task, including those spawned 
+*    along the way, is done.
+***********************************************************/
+template <typename Task>
+class StealingPool {
+private:
+    struct Queue {
+        mutex lock;
+        deque<Task> tasks;
+    };
+    
+    vector<Queue> queues;
+    atomic<long> unfinished;    // Tasks pushed but not yet run to the end
+    
+    bool pop(int worker, Task& task) {
+        {
+            Queue& own = queues[worker];
+            lock_guard<mutex> guard(own.lock);
+            if (!own.tasks.empty()) {
+                task = move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (size_t i = 1; i < queues.size(); i++) {
+            Queue& other = queues[(worker + i) % queues.size()];
+            lock_guard<mutex> guard(other.lock);
+            if (!other.tasks.empty()) {
+                task = move(other.tasks.front());
+                other.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+public:
+    // Constructor
+    StealingPool(int workers) : queues(max(1, workers)), unfinished(0) {}
+    
+    int size() const {
+        return static_cast<int>(queues.size());
+    }
+    
+    // Queue a task on `worker`'s queue
+    void push(int worker, Task&& task) {
+        unfinished++;
+        Queue& own = queues[worker];
+        lock_guard<mutex> guard(own.lock);
+        own.tasks.push_back(move(task));
+    }
+    
+    // Run every task with `body(worker, task)` until none are left
+    template <typename Body>
+    void run(Body body) {
+        auto work = [&](int worker) {
+            Task task;
+            while (unfinished.load() > 0) {
+                if (pop(worker, task)) {
+                    body(worker, task);
+                    unfinished--;   // After `body` has pushed what it spawned
+                } else {
+                    this_thread::yield();
+                }
+            }
+        };
+        
+        vector<thread> pool;
+        for (int id = 1; id < size(); id++) {
+            pool.emplace_back(work, id);
+        }
+        work(0);
+        for (thread& t : pool) {
+            t.join();
+        }
+    }
+};
+
+/************************************************************
+*    Grades a strategy by playing it against every secret 
+*    code of a board:
+*      --evaluate <length> <y|n> <strategy> [budget] 
+*                 [--colors <n>] [--book <file>] 
+*                 [--tree <file>] [--threads <n>]
+*    Secrets that get the same hints are played the same 
+*    way, so rather than one game per secret the strategy's 
+*    decision tree is walked once: a node holds the codes 
+*    still possible, its guess splits them by hint into its 
+*    children, and the secret equal to the guess is solved 
+*    at the node's depth. Nodes are tasks on a work-stealing 
+*    pool. Guesses come from the opening book when it covers 
+*    the node, else from the solver, and the guess for a set 
+*    of codes is remembered, so a set reached again along 
+*    another path costs no search. Only a histogram of 
+*    guesses per secret is kept; with --tree every node is 
+*    written out as it is played, one line each:
+*      <id> <parent id> <hint from parent> <guess> <codes>
+*    Each move gets `budget` seconds (1 by default), so on 
+*    boards too large to search in full the results can vary 
+*    slightly from run to run.
+***********************************************************/
+int runEvaluate(int argc, char* argv[]) {
+    int colors = 8;
+    int numThreads = max(1u, thread::hardware_concurrency());
+    OpeningBook openingBook;
+    const char* bookFile = nullptr;
+    const char* treeFile = nullptr;
+    
+    // Take out the options; the settings are the remaining arguments
+    vector<char*> args;
+    for (int i = 0; i < argc; i++) {
+        if (strcmp(argv[i], "--colors") == 0 && i + 1 < argc) {
+            colors = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--book") == 0 && i + 1 < argc) {
+            bookFile = argv[++i];
+        } else if (strcmp(argv[i], "--tree") == 0 && i + 1 < argc) {
+            treeFile = argv[++i];
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            numThreads = atoi(argv[++i]);
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+    argc = static_cast<int>(args.size());
+    argv = args.data();
+    
+    if (argc < 5 || argc > 6) {
+        cerr << "Usage: " << argv[0] << " --evaluate <length> <y|n> "
+                "<minimax|expected|entropy|first> [budget] [--colors <n>] "
+                "[--book <file>] [--tree <file>] [--threads <n>]" << endl;
+        return 1;
+    }
+    int length = atoi(argv[2]);
+    char choiceDuplicate = tolower(argv[3][0]);
+    int strategy = strategyByName(argv[4]);
+    double budget = (argc > 5) ? atof(argv[5]) : 1.0;
+    
+    if (!validBoard(length, colors, choiceDuplicate) || strategy == 0 || 
+        budget <= 0 || numThreads < 1) {
+        cerr << "Error: invalid evaluation settings." << endl;
+        return 1;
+    }
+    if (!Solver::canSolve(length, colors, choiceDuplicate)) {
+        cerr << "Error: the board has more than " << Solver::maxCodes 
+             << " codes, too many for the solver." << endl;
+        return 1;
+    }
+    if (bookFile != nullptr && !openingBook.load(bookFile)) {
+        cerr << "Error: " << bookFile << " is not a valid opening book." << endl;
+        return 1;
+    }
+    ofstream tree;
+    if (treeFile != nullptr) {
+        tree.open(treeFile, ios::trunc);
+        if (!tree) {
+            cerr << "Error: cannot write " << treeFile << endl;
+            return 1;
+        }
+        tree << "# id parent hint guess codes\n";
+    }
+    
+    // A node of the decision tree still to be played
+    struct Node {
+        Code* codes;            // Secrets that reach this node, in `allCodes`
+        size_t count;
+        uint64_t parent;        // Id of the parent node, 0 for the root
+        int depth;              // Guess number played here
+        int bookSlot;           // Slot in the opening book, or -1
+        const char* hint;       // Hint text leading here from the parent
+    };
+    
+    // What each worker has seen, and its scratch space
+    struct WorkerState {
+        vector<uint64_t> solvedAt;  // Secrets solved with each number of guesses
+        string treeText;            // Tree lines not yet written
+        uint64_t memoHits = 0;
+        vector<Feedback> scores = vector<Feedback>(4096);
+        vector<uint8_t> classes;    // Feedback index of each code of a node
+        vector<Code> sorted;        // A node's codes grouped by feedback
+    };
+    
+    const EngineOps& engine = selectEngine(length, choiceDuplicate);
+    const int board = boardIndex(length, colors, choiceDuplicate);
+    const int numFeedbacks = (length + 1) * (length + 1);
+    StealingPool<Node> pool(numThreads);
+    vector<WorkerState> states(pool.size());
+    atomic<uint64_t> nextId(1);
+    mutex treeLock;
+    mutex memoLock;
+    
+    // A remembered guess, with enough of its set to tell apart 
+    // another set that happens to hash the same
+    struct MemoEntry {
+        Code guess;
+        size_t count;
+        Code first;
+        Code last;
+    };
+    unordered_map<uint64_t, MemoEntry> memo;    // Guess for a set of codes, by hash
+    
+    auto writeTree = [&](WorkerState& state, bool force) {
+        if (treeFile != nullptr && 
+            (state.treeText.size() >= (1 << 16) || (force && !state.treeText.empty()))) {
+            lock_guard<mutex> guard(treeLock);
+            tree.write(state.treeText.data(), state.treeText.size());
+            state.treeText.clear();
+        }
+    };
+    
+    // Note a node in the tree
+    auto addNode = [&](WorkerState& state, uint64_t id, uint64_t parent, 
+                       const char* hint, const Code& guess, size_t codes) {
+        if (treeFile != nullptr) {
+            char digits[24];
+            for (uint64_t value : {id, parent}) {
+                to_chars_result result = to_chars(digits, digits + sizeof(digits), value);
+                state.treeText.append(digits, result.ptr - digits);
+                state.treeText += ' ';
+            }
+            state.treeText += hint;
+            state.treeText += ' ';
+            state.treeText += guess.toString();
+            state.treeText += ' ';
+            to_chars_result result = to_chars(digits, digits + sizeof(digits), codes);
+            state.treeText.append(digits, result.ptr - digits);
+            state.treeText += '\n';
+            writeTree(state, false);
+        }
+    };
+    // Count a secret solved with `depth` guesses
+    auto solved = [&](WorkerState& state, int depth) {
+        if (state.solvedAt.size() <= static_cast<size_t>(depth)) {
+            state.solvedAt.resize(depth + 1, 0);
+        }
+        state.solvedAt[depth]++;
+    };
+    
+    auto playNode = [&](int worker, Node& node) {
+        WorkerState& state = states[worker];
+        Code* codes = node.codes;
+        const size_t count = node.count;
+        
+        // Choose the guess: the book, then the memo, then the solver, 
+        // which takes the first code of small sets anyway
+        Code guess = codes[0];
+        bool known = (node.bookSlot >= 0 && 
+                      openingBook.lookup(board, strategy, node.bookSlot, guess)) || 
+                     count <= 2 || strategy == FIRST_CONSISTENT;
+        bool remembered = false;
+        uint64_t key = count;
+        if (!known) {
+            for (size_t i = 0; i < count; i++) {
+                key = (key ^ codes[i].bits) * 0x9E3779B97F4A7C15ull;
+                key ^= key >> 29;
+            }
+            lock_guard<mutex> guard(memoLock);
+            auto found = memo.find(key);
+            if (found != memo.end() && found->second.count == count && 
+                found->second.first == codes[0] && 
+                found->second.last == codes[count - 1]) {
+                guess = found->second.guess;
+                known = true;
+                remembered = true;
+            }
+        }
+        
+        // Group the codes by the hint they give. A remembered guess 
+        // that leaves every code with the same hint came from another 
+        // set after all, so the solver chooses again.
+        const int win = length * (length + 1);
+        uint32_t sizes[(maxPegs + 1) * (maxPegs + 1)];
+        vector<uint8_t>& classes = state.classes;
+        vector<Feedback>& scores = state.scores;
+        classes.resize(count);
+        for (;;) {
+            if (!known) {
+                Solver solver(length, colors, choiceDuplicate, 
+                              static_cast<SolverStrategy>(strategy), budget, 
+                              vector<Code>(codes, codes + count));
+                if (count < 65536 || pool.size() > 1) {
+                    solver.setThreads(1);   // The pool keeps the cores busy
+                }
+                guess = solver.nextGuess();
+                lock_guard<mutex> guard(memoLock);
+                memo[key] = {guess, count, codes[0], codes[count - 1]};
+            }
+            fill(sizes, sizes + numFeedbacks, 0);
+            for (size_t start = 0; start < count; start += scores.size()) {
+                size_t n = min(scores.size(), count - start);
+                engine.scoreBatch(guess, codes + start, n, scores.data());
+                for (size_t i = 0; i < n; i++) {
+                    int index = scores[i].black * (length + 1) + scores[i].white;
+                    classes[start + i] = static_cast<uint8_t>(index);
+                    sizes[index]++;
+                }
+            }
+            if (!remembered || classes[0] == win || sizes[classes[0]] < count) {
+                break;
+            }
+            known = false;
+            remembered = false;
+        }
+        if (remembered) {
+            state.memoHits++;
+        }
+        
+        uint64_t id = nextId++;
+        addNode(state, id, node.parent, node.hint, guess, count);
+        
+        // Put each group together, in place
+        uint32_t offsets[(maxPegs + 1) * (maxPegs + 1)];
+        uint32_t offset = 0;
+        for (int index = 0; index < numFeedbacks; index++) {
+            offsets[index] = offset;
+            offset += sizes[index];
+        }
+        state.sorted.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            state.sorted[offsets[classes[i]]++] = codes[i];
+        }
+        copy(state.sorted.begin(), state.sorted.begin() + count, codes);
+        
+        if (sizes[win] > 0) {
+            solved(state, node.depth);
+        }
+        Code* part = codes;
+        for (int index = 0; index < numFeedbacks; part += sizes[index], index++) {
+            if (index == win || sizes[index] == 0) {
+                continue;
+            }
+            Feedback fb;
+            fb.black = static_cast<uint8_t>(index / (length + 1));
+            fb.white = static_cast<uint8_t>(index % (length + 1));
+            const char* hint = engine.hint(fb);
+            
+            // A single code is guessed next; no need for a task
+            if (sizes[index] == 1) {
+                addNode(state, nextId++, id, hint, part[0], 1);
+                solved(state, node.depth + 1);
+                continue;
+            }
+            Node child;
+            child.codes = part;
+            child.count = sizes[index];
+            child.parent = id;
+            child.depth = node.depth + 1;
+            child.bookSlot = (node.bookSlot == 0) ? OpeningBook::replySlot(length, fb) 
+                                                  : -1;
+            child.hint = hint;
+            pool.push(worker, move(child));
+        }
+    };
+    
+    // Every node works on its own range of this array
+    auto start = chrono::steady_clock::now();
+    vector<Code> allCodes;
+    enumerateCodes(length, colors, choiceDuplicate, allCodes);
+    const uint64_t numCodes = allCodes.size();
+    Node root;
+    root.codes = allCodes.data();
+    root.count = allCodes.size();
+    root.parent = 0;
+    root.depth = 1;
+    root.bookSlot = 0;
+    root.hint = "-";
+    pool.push(0, move(root));
+    pool.run(playNode);
+    for (WorkerState& state : states) {
+        writeTree(state, true);
+    }
+    double seconds = chrono::duration<double>(
+                     chrono::steady_clock::now() - start).count();
+    
+    // Merge the workers' counts
+    vector<uint64_t> solvedAt;
+    uint64_t memoHits = 0;
+    for (const WorkerState& state : states) {
+        if (solvedAt.size() < state.solvedAt.size()) {
+            solvedAt.resize(state.solvedAt.size(), 0);
+        }
+        for (size_t depth = 0; depth < state.solvedAt.size(); depth++) {
+            solvedAt[depth] += state.solvedAt[depth];
+        }
+        memoHits += state.memoHits;
+    }
+    uint64_t totalGuesses = 0, overLimit = 0;
+    int limit = turnLimit(length, colors);
+    for (size_t depth = 1; depth < solvedAt.size(); depth++) {
+        totalGuesses += depth * solvedAt[depth];
+        if (depth > static_cast<size_t>(limit)) {
+            overLimit += solvedAt[depth];
+        }
+    }
+    
+    cout << "Length: " << length << ", Colors: " << colors 
+         << ", Duplicates: " << choiceDuplicate << ", Strategy: " 
+         << strategyNames[strategy] << ", Codes: " << numCodes << endl;
+    cout << "\nGuesses  Codes  Percent" << endl;
+    for (size_t depth = 1; depth < solvedAt.size(); depth++) {
+        cout << depth << "\t" << solvedAt[depth] << "\t" 
+             << 100.0 * solvedAt[depth] / numCodes << "%" << endl;
+    }
+    cout << "Worst case: " << solvedAt.size() - 1 << " guesses, Average: " 
+         << static_cast<double>(totalGuesses) / numCodes << " guesses" << endl;
+    cout << "Lost (over " << limit << " turns): " << overLimit << endl;
+    cout << "Tree nodes: " << nextId - 1 << ", Memo hits: " << memoHits 
+         << ", Threads: " << pool.size() << ", Elapsed: " << seconds << " s" << endl;
+    if (treeFile != nullptr) {
+        tree.flush();
+        if (!tree) {
+            cerr << "Error: cannot write " << treeFile << endl;
+            return 1;
+        }
     }
+    return 0;
 }
 
 /************************************************************
-*    Displays the instructions for the Mastermind game, 
-*    explaining the rules, the goal of the game, how guesses 
-*    and hints work, and how to enter valid inputs.
- ***********************************************************/
-void showInstructions(){
-    for(int i = 0 ; i < 80; i++){
-        cout << "*";
-    }
+*    Timing statistics for one benchmark case, in nanoseconds 
+*    per operation over all measured repetitions.
+***********************************************************/
+struct BenchResult {
+    string name;
+    long size;
+    int reps;
+    double minNs;
+    double medianNs;
+    double meanNs;
+    double stddevNs;
+};
+
+/************************************************************
+*    Runs `body` (which performs `ops` operations) a few times 
+*    to warm up caches and the branch predictor, then times 
+*    `reps` repetitions and summarizes them.
+***********************************************************/
+template <typename Body>
+BenchResult runBenchmark(const string& name, long size, long ops, Body body) {
+    const int warmups = 2;
+    const int reps = 15;
+    vector<double> samples;
     
-    cout << endl;
-    cout << "*\t\t\tThis is Mastermind!" << endl << "*" << endl;
-    cout << "*\tThe goal of the game is to guess the code the computer generated.";
-    cout << endl << "*" << endl;
-    cout << "*\tYou have 10 attempts to guess the code." << endl;
-    cout << "*\tIn order to enter your guess, please type numbers from 1 to 8, "
-            "\n*\taccording to the code size you selected (4, 6 or 8 digits).";
-    cout << endl << "*" << endl;
-    cout << "*\tFor every guess you entered, you will be given a hint in the form:";
-    cout << endl << "*" << endl;
-    cout << "*\tOOX_" << endl << "*" << endl;
-    cout << "*\tThe symbols above represents the amount of digits in the right "
-            "\n*\tposition, wrong position and incorrect digits from your guess: ";
-    cout << endl;
-    cout << "*\tO: One digit in the right position." << endl;
-    cout << "*\tX: One digit in the wrong position. " << endl;
-    cout << "*\t_: One incorrect digit." << endl << "*" << endl;    
-    cout << "*\tFor instance, if the secret code is '1234' and your guess was "
-            "\n*\t'5247', the hint will be OX__, because '2' was in the right "
-            "\n*\tposition, '4' was in the wrong position and '5' and '7' were "
-            "\n*\tincorrect digits. As you can notice, the hint does not show you "
-            "\n*\twhat digit's place was right, wrong or incorrect, it only shows "
-            "\n*\tthe amount." << endl << "*" << endl;
-    cout << "*\t\t\tHAPPY GUESSING! :D" << endl;
+    for (int i = 0; i < warmups; i++) {
+        body();
+    }
+    for (int i = 0; i < reps; i++) {
+        auto start = chrono::steady_clock::now();
+        body();
+        samples.push_back(chrono::duration<double, nano>(
+                          chrono::steady_clock::now() - start).count() / ops);
+    }
     
-    for(int i = 0 ; i < 80; i++){
-        cout << "*";
+    sort(samples.begin(), samples.end());
+    double mean = accumulate(samples.begin(), samples.end(), 0.0) / reps;
+    double variance = 0;
+    for (double x : samples) {
+        variance += (x - mean) * (x - mean);
     }
-    cout << endl;
+    
+    BenchResult result;
+    result.name = name;
+    result.size = size;
+    result.reps = reps;
+    result.minNs = samples.front();
+    result.medianNs = samples[reps / 2];
+    result.meanNs = mean;
+    result.stddevNs = sqrt(variance / (reps - 1));
+    return result;
 }
 
 /************************************************************
-*    Validates the player's guess input for correctness 
-*    in terms of format, length, and valid characters (1-8).
- ***********************************************************/
-void validInput(const string &guess_input, bool &skipTurn, const int &length){
-    try {
-        if (guess_input.empty()){ 
-            throw invalid_argument("Input cannot be empty. Please try again.");
+*    Times the core kernels at several input sizes and writes 
+*    the results as JSON, to stdout or to the file named on 
+*    the command line:
+*      --bench [output.json]
+***********************************************************/
+int runBench(int argc, char* argv[]) {
+    vector<BenchResult> results;
+    volatile unsigned long sink = 0; // Keeps results from being optimized away
+    const int lengths[] = {4, 6, 8};
+    const long sizes[] = {1000, 10000, 100000};
+    
+    setupGame(1);
+    
+    // Secret code generation for every board setting, one at a time and in bulk
+    for (int length : lengths) {
+        for (char dup : {'y', 'n'}) {
+            const long ops = 10000;
+            results.push_back(runBenchmark(
+                "genCode/len" + to_string(length) + "/dup_" + dup, length, ops, 
+                [&]() {
+                    Code code;
+                    for (long i = 0; i < ops; i++) {
+                        genCode(length, 8, code, dup);
+                        sink = sink + code.bits;
+                    }
+                }));
+            
+            vector<Code> buffer(ops);
+            results.push_back(runBenchmark(
+                "CodeGenerator::generate/len" + to_string(length) + "/dup_" + dup, 
+                length, ops, [&]() {
+                    codeGenerator.generate(length, 8, dup, buffer.data(), ops);
+                    sink = sink + buffer[ops - 1].bits;
+                }));
+        }
+    }
+    
+    // Scoring: one pair at a time, the printing path, and the batch kernel, 
+    // on the classic boards and a 12-peg, 16-color one
+    for (int length : {4, 6, 8, 12}) {
+        int colors = (length > 8) ? 16 : 8;
+        string board = "/len" + to_string(length) + 
+                       (colors != 8 ? "/colors" + to_string(colors) : "");
+        vector<Code> codes;
+        for (long i = 0; i < 4096; i++) {
+            Code code;
+            genCode(length, colors, code, 'y');
+            codes.push_back(code);
+        }
+        const long ops = static_cast<long>(codes.size());
+        
+        results.push_back(runBenchmark(
+            "scoreGuess" + board, length, ops, [&]() {
+                for (long i = 0; i < ops; i++) {
+                    sink = sink + scoreGuess(codes[0], codes[i]).black;
+                }
+            }));
+        results.push_back(runBenchmark(
+            "hint" + board, length, ops, [&]() {
+                for (long i = 0; i < ops; i++) {
+                    hint(codes[i], codes[0], false);
+                }
+            }));
+        
+        vector<Feedback> out(codes.size());
+        results.push_back(runBenchmark(
+            "scoreBatch" + board, length, ops, [&]() {
+                scoreBatch(codes[0], codes.data(), codes.size(), out.data());
+                sink = sink + out[ops - 1].white;
+            }));
+        
+        const EngineOps& engine = selectEngine(length, 'y');
+        results.push_back(runBenchmark(
+            "Engine::scoreBatch" + board, length, ops, [&]() {
+                engine.scoreBatch(codes[0], codes.data(), codes.size(), out.data());
+                sink = sink + out[ops - 1].white;
+            }));
+        
+        results.push_back(runBenchmark(
+            "RSHash" + board, length, ops, [&]() {
+                for (long i = 0; i < ops; i++) {
+                    sink = sink + RSHash(codes[i]);
+                }
+            }));
+    }
+    
+    // Narrowing every code of a board to those fitting a first hint
+    for (int length : lengths) {
+        CandidateSet candidates;
+        Code secret, guess;
+        genCode(length, 8, secret, 'y');
+        genCode(length, 8, guess, 'y');
+        Feedback fb = scoreGuess(guess, secret);
+        const long ops = static_cast<long>(codeSpace(length, 8, 'y'));
+        results.push_back(runBenchmark(
+            "CandidateSet::update/len" + to_string(length), length, ops, [&]() {
+                candidates.reset(length, 8, 'y');
+                candidates.update(guess, fb);
+                sink = sink + candidates.remaining();
+            }));
+    }
+    
+    // Hash table, results tree, score sorting and history queries as the 
+    // history grows
+    for (long size : sizes) {
+        vector<Code> codes(size);
+        const int config = boardIndex(8, 8, 'y');
+        for (Code& code : codes) {
+            genCode(8, 8, code, 'y');
         }
-        if (!all_of(guess_input.begin(), guess_input.end(), ::isdigit)){ 
-            throw invalid_argument("Guess contains invalid characters. Use only numbers.");
+        
+        results.push_back(runBenchmark("HashTable::insert", size, size, [&]() {
+            HashTable table(8);
+            for (const Code& code : codes) {
+                table.insert(code, config);
+            }
+        }));
+        
+        HashTable table(8);
+        for (const Code& code : codes) {
+            table.insert(code, config);
         }
-        if (guess_input.size() != length){ 
-            throw invalid_argument("Guess length does not match the code length.");
+        const long searches = 1000;
+        results.push_back(runBenchmark("HashTable::search", size, searches, [&]() {
+            for (long i = 0; i < searches; i++) {
+                sink = sink + table.search(codes[(i * 7919) % size], config);
+            }
+        }));
+        
+        long treeSize = size;
+        NodeArena arena;
+        results.push_back(runBenchmark("TreeNode::insert", treeSize, treeSize, [&]() {
+            TreeNode* root = nullptr;
+            arena.reset();
+            for (long i = 0; i < treeSize; i++) {
+                insert(root, GameResult(lengths[i % 3], 8, (i & 1) ? 'y' : 'n', 
+                                        i % 5 == 0, 1 + i % numTurns), i, arena);
+            }
+        }));
+        
+        TreeNode* root = nullptr;
+        arena.reset();
+        for (long i = 0; i < treeSize; i++) {
+            insert(root, GameResult(lengths[i % 3], 8, (i & 1) ? 'y' : 'n', 
+                                    i % 5 == 0, 1 + i % numTurns), i, arena);
         }
-        for (char ch : guess_input) {
-            if (ch < '1' || ch > '8') 
-                throw invalid_argument("Guess contains invalid numbers. Only use 1 to 8.");
+        vector<pair<string, int>> scores;
+        results.push_back(runBenchmark("extractScores", treeSize, treeSize, [&]() {
+            scores.clear();
+            extractScores(root, scores);
+        }));
+        
+        results.push_back(runBenchmark("mergeSort", treeSize, treeSize, [&]() {
+            vector<pair<string, int>> sorted = scores;
+            mergeSort(sorted, [](const pair<string, int>& a, 
+                                 const pair<string, int>& b) {
+                return a.second > b.second;
+            });
+            sink = sink + sorted[0].second;
+        }));
+        
+        GameHistory history;
+        for (long i = 0; i < size; i++) {
+            history.append(config, i % 5 != 0, 1 + i % numTurns, 
+                           static_cast<uint32_t>(i % 1000), &codes[i], 1);
         }
-    } catch (const invalid_argument& e) {
-        cout << "Error: " << e.what() << endl;
-        skipTurn = true; // Skip turn if an invalid guess was made
+        results.push_back(runBenchmark("GameHistory::summarize", size, size, [&]() {
+            sink = sink + history.summarize(config).turnsUsed;
+        }));
+        
+        vector<long> counts(numTurns + 1);
+        results.push_back(runBenchmark("GameHistory::turnHistogram", size, size, 
+                                       [&]() {
+            history.turnHistogram(config, counts.data());
+            sink = sink + counts[numTurns];
+        }));
+        
+        const double fractions[] = {0.50, 0.90, 0.99};
+        uint32_t times[3];
+        results.push_back(runBenchmark("GameHistory::elapsedPercentiles", size, 
+                                       size, [&]() {
+            history.elapsedPercentiles(config, fractions, 3, times);
+            sink = sink + times[2];
+        }));
     }
-}
-
-/************************************************************
-*    Compares the player's guess to the generated code, 
-*    provides feedback through hints, and determines if the 
-*    game is won or lost.
- ***********************************************************/
-void compareGuess(list<char>& guess, const string& guess_input, 
-                  const list<char>& code, bool& endGame, stack<int>& turns,
-                  const int &length, const char &choiceDuplicate,
-                  TreeNode*& resultsTree) {  // TreeNode* instead of queue
-    guess.clear();
-    for (char ch : guess_input){ 
-        guess.push_back(ch);
-    }
-
-    if (code == guess) {
-        endGame = true;
-        recordResult(length, choiceDuplicate, true, resultsTree); // Record win
-        cout << "Congratulations!! You win !!" << endl; 
-        while(!turns.empty()){
-            turns.pop();
+    
+    ostringstream json;
+    json << "{\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        json << "    {\"name\": \"" << r.name << "\", \"size\": " << r.size 
+             << ", \"reps\": " << r.reps << ", \"ns_per_op\": {\"min\": " << r.minNs 
+             << ", \"median\": " << r.medianNs << ", \"mean\": " << r.meanNs 
+             << ", \"stddev\": " << r.stddevNs << "}}" 
+             << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    json << "  ]\n}\n";
+    
+    if (argc > 2) {
+        ofstream file(argv[2]);
+        if (!file) {
+            cerr << "Error: cannot write " << argv[2] << endl;
+            return 1;
         }
+        file << json.str();
     } else {
-        hint(code, guess);
-        if (!turns.empty()) {
-            turns.pop();
-            cout << "Turns left: " << (turns.empty() ? 0 : turns.top()) << endl;
-            if(turns.empty()){
-                recordResult(length, choiceDuplicate, false, resultsTree); // Record loss
-            }
-        }
+        cout << json.str();
     }
+    return 0;
 }
 
 /************************************************************
-*    Asks the player for confirmation to exit the game and 
-*    sets the quit flag if the player confirms.
- ***********************************************************/
-void  exitingGame(bool &quit){
-    char confirm;
-    cout << "Are you sure you want to quit? [y/n]: ";
-    cin >> confirm;
-    if (tolower(confirm) == 'y') {
-        cout << "Exiting game. Thanks for playing!" << endl;
-        quit = true; // Set quit flag to exit loop
-    }    
-}
+*    Results and generated codes shared by every game the 
+*    server hosts. Workers record into them under `lock`.
+***********************************************************/
+struct ServerHistory {
+    mutex lock;
+    ResultsIndex results;
+    HashTable hashTable;
+    ServerHistory() : hashTable(8) {}
+};
 
 /************************************************************
-*    Records the outcome of a single game (win/loss) and its 
-*    settings into a queue for tracking game results.
- ***********************************************************/
-void recordResult(int codeLength, char duplicateSetting, bool isWin, 
-                  TreeNode*& resultsTree) {  // TreeNode* instead of queue
-    GameResult gr(codeLength, duplicateSetting, isWin);
-    insert(resultsTree, gr); // Insert into the tree
-}
+*    One client connection of the game server, with the game 
+*    it is playing and its unsent and unparsed bytes.
+***********************************************************/
+struct ServerSession {
+    int fd;
+    string input;       // Received bytes not yet ending in a newline
+    string output;      // Reply bytes the socket has not accepted yet
+    GameSession game;   // Current or last game
+    GameTrace trace;    // Start time and guesses of `game`
+    bool closing;       // Close once `output` has been sent
+    
+    ServerSession(int fd) {
+        this->fd = fd;
+        closing = false;
+    }
+};
 
 /************************************************************
-*    Displays the statistics of the game results, including 
-*    wins and losses for different code lengths (4, 6, 8) and 
-*    settings for duplicates, and compares the number of wins 
-*    with and without duplicates.
- ***********************************************************/
-void displayStatistics(TreeNode* resultsTree) {  // TreeNode* instead of queue
-    cout << "\nSCORES IN HISTORY ORDER:" << endl;
-    printInOrder(resultsTree);  // Print tree in sorted order
-    cout << endl;
-}
+*    A worker of the game server. Each worker runs its own 
+*    epoll loop over the connections handed to it by the 
+*    accept loop, so a session is only ever touched by one 
+*    thread and needs no locking. New connections arrive 
+*    through a queue and an eventfd that wakes the loop.
+***********************************************************/
+class ServerWorker {
+private:
+    int epollFd;
+    int wakeFd;                         // eventfd signalled for new connections
+    mutex pendingLock;
+    vector<int> pending;                // Accepted sockets not yet registered
+    map<int, ServerSession*> sessions;  // Open connections by socket
+    CodeGenerator generator;            // This worker's stream of secret codes
+    ServerHistory& history;
+    const atomic<bool>& stopping;
+    
+    void registerPending();
+    void handleLine(ServerSession& session, string_view line);
+    void readFrom(ServerSession& session);
+    void flush(ServerSession& session);
+    void closeSession(ServerSession* session);
 
-/************************************************************
-*    Create a visually striking title screen for the game.
- ***********************************************************/
-void printWelcome(){
-    cout << endl;
-    cout << "              (           )    *                    )      *      "
-            "     (             (      *    (       ) (      " << endl;
-    cout << " (  (         )\\ )  (  ( /(  (  `          *   ) ( /(    (  `    ("
-            "     )\\ ) *   )    )\\ ) (  `   )\\ ) ( /( )\\ )   " << endl;
-    cout << " )\\))(   '(  (()/(  )\\ )\\()) )\\))(  (    ` )  /( )\\())   )\\))(   )"
-            "\\   (()/` )  /((  (()/( )\\))( (()/( )\\()(()/(   " << endl;
-    cout << "((_)()\\ ) )\\  /(_)(((_((_)\\ ((_)()\\ )\\    ( )(_)((_)\\   ((_)()(((("
-            "_)(  /(_)( )(_))\\  /(_)((_)()\\ /(_)((_)\\ /(_))  " << endl;
-    cout << "_(())\\_)(((_)(_)) )\\___ ((_)(_()((_((_)  (_(_())  ((_)  (_()((_)\\ "
-            "_ )\\(_))(_(_()((_)(_)) (_()((_(_))  _((_(_))_   " << endl;
-    cout << "\\ \\((_)/ | __| | ((/ __/ _ \\|  \\/  | __| |_   _| / _ \\  |  \\/  (_)"
-            "_\\(_/ __|_   _| __| _ \\|  \\/  |_ _|| \\| ||   \\  " << endl;
-    cout << " \\ \\/\\/ /| _|| |__| (_| (_) | |\\/| | _|    | |  | (_) | | |\\/| |/ "
-            "_ \\ \\__ \\ | | | _||   /| |\\/| || | | .` || |) | " << endl;
-    cout << "  \\_/\\_/ |___|____|\\___\\___/|_|  |_|___|   |_|   \\___/  |_|  |_/_/"
-            " \\_\\|___/ |_| |___|_|_\\|_|  |_|___||_|\\_||___/  " << endl << endl;    
-}
+public:
+    ServerWorker(uint64_t seed, int id, ServerHistory& history, 
+                 const atomic<bool>& stopping) 
+        : generator(seed, id), history(history), stopping(stopping) {
+        epollFd = epoll_create1(0);
+        wakeFd = eventfd(0, EFD_NONBLOCK);
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.ptr = nullptr;   // Marks the wake-up eventfd
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+    }
+    
+    ~ServerWorker() {
+        for (auto& entry : sessions) {
+            close(entry.first);
+            delete entry.second;
+        }
+        for (int fd : pending) {
+            close(fd);
+        }
+        close(wakeFd);
+        close(epollFd);
+    }
+    
+    ServerWorker(const ServerWorker&) = delete;
+    ServerWorker& operator=(const ServerWorker&) = delete;
+    
+    // Hand a newly accepted socket to this worker
+    void adopt(int fd) {
+        {
+            lock_guard<mutex> guard(pendingLock);
+            pending.push_back(fd);
+        }
+        uint64_t one = 1;
+        if (write(wakeFd, &one, sizeof(one)) < 0) {
+            // The counter is already nonzero, so the worker will wake anyway
+        }
+    }
+    
+    void run();
+    
+#ifdef MASTERMIND_ALLOC_CHECK
+    // Drives handleLine without a socket
+    friend int runAllocCheck(int, char*[]);
+#endif
+};
 
 /************************************************************
-*    Create a ASCII art-style game over message.
- ***********************************************************/
-void printGameOver(){
-    cout << endl;
-    cout << "  #####     #    #     # #######       #######  #     # ####### ######  " << endl;
-    cout << " #     #   # #   ##   ## #             #     #  #     # #       #     # " << endl;
-    cout << " #        #   #  # # # # #             #     #  #     # #       #     # " << endl;
-    cout << " #  #### #     # #  #  # #####         #     #  #     # #####   ######  " << endl;
-    cout << " #     # ####### #     # #             #     #   #   #  #       #   #   " << endl;
-    cout << " #     # #     # #     # #             #     #    # #   #       #    #  " << endl;
-    cout << "  #####  #     # #     # #######       #######     #    ####### #     # " << endl;
-    cout << endl;
+*    Registers the sockets queued by `adopt` with this 
+*    worker's epoll set and greets each client.
+***********************************************************/
+void ServerWorker::registerPending() {
+    uint64_t count;
+    if (read(wakeFd, &count, sizeof(count)) < 0) {
+        // Nothing queued since the last wake-up
+    }
+    vector<int> fds;
+    {
+        lock_guard<mutex> guard(pendingLock);
+        fds.swap(pending);
+    }
+    for (int fd : fds) {
+        ServerSession* session = new ServerSession(fd);
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.ptr = session;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+        sessions[fd] = session;
+        session->output = "WELCOME Mastermind. Commands: NEW <length> <y|n> "
+                          "[colors], GUESS <code>, STATS, QUIT\n";
+        flush(*session);
+    }
 }
 
 /************************************************************
-*    Inserts a `GameResult` object into a binary search tree 
-*    based on the code length and duplicate setting.
+*    Runs one command from a client and queues the reply:
+*      NEW <length> <y|n> [colors]
+*                         ->  READY <length> <y|n> <turns> <colors>
+*      GUESS <code>       ->  HINT <hint> <turns left>, 
+*                             followed by LOSE <code> on the 
+*                             last turn, or WIN <turns used>
+*      STATS              ->  STATS <games> <wins> <losses>
+*      QUIT               ->  BYE
+*    The length is 1 to 15 and the colors 2 to 16 (8 when 
+*    left out).
+*    Bad commands and guesses get an "Error: ..." line and do 
+*    not use up a turn. The line is split into string_views 
+*    in place and the reply is appended straight to the 
+*    session's output, so once the session's buffers have 
+*    grown a command allocates nothing.
 ***********************************************************/
-void insert(TreeNode*& root, GameResult gr) {
-    if (root == nullptr) {
-        root = new TreeNode(gr);
-    } else if (gr.codeLength < root->result.codeLength || 
-               (gr.codeLength == root->result.codeLength && gr.duplicateSetting < root->result.duplicateSetting)) {
-        insert(root->left, gr);
-    } else {
-        insert(root->right, gr);
+void ServerWorker::handleLine(ServerSession& session, string_view line) {
+    string& reply = session.output;
+    char digits[24];
+    auto appendNumber = [&](long value) {
+        to_chars_result result = to_chars(digits, digits + sizeof(digits), value);
+        reply.append(digits, result.ptr - digits);
+    };
+    
+    string_view rest = line;
+    string_view command = nextWord(rest);
+    auto isCommand = [&](string_view name) {
+        return command.size() == name.size() && 
+               equal(command.begin(), command.end(), name.begin(), 
+                     [](char a, char b) { 
+                         return toupper(static_cast<unsigned char>(a)) == b; 
+                     });
+    };
+    
+    if (isCommand("NEW")) {
+        int length = 0;
+        int colors = 8;
+        bool ok = parseNumber(nextWord(rest), length);
+        string_view duplicates = nextWord(rest);
+        string_view colorsWord = nextWord(rest);
+        ok = ok && duplicates.size() == 1 && 
+             (colorsWord.empty() || parseNumber(colorsWord, colors));
+        char choiceDuplicate = ok ? tolower(duplicates[0]) : '\0';
+        if (!ok || !validBoard(length, colors, choiceDuplicate)) {
+            reply += "Error: Invalid settings. Use NEW <1-15> <y|n> [2-16].\n";
+        } else {
+            session.game.start(length, colors, choiceDuplicate, generator);
+            session.trace.begin();
+            {
+                lock_guard<mutex> guard(history.lock);
+                history.hashTable.insert(session.game.getCode(), 
+                                         boardIndex(length, colors, choiceDuplicate));
+                history.results.reserve(length, colors, choiceDuplicate);
+            }
+            reply += "READY ";
+            appendNumber(length);
+            reply += ' ';
+            reply += choiceDuplicate;
+            reply += ' ';
+            appendNumber(session.game.getTurnLimit());
+            reply += ' ';
+            appendNumber(colors);
+            reply += '\n';
+        }
+    } else if (isCommand("GUESS")) {
+        string_view guess_input = nextWord(rest);
+        GameSession& game = session.game;
+        InputError error = game.isPlaying() ? 
+            checkGuess(guess_input, game.getLength(), game.getColors()) : INPUT_OK;
+        if (!game.isPlaying()) {
+            reply += "Error: No game in progress. Use NEW first.\n";
+        } else if (error != INPUT_OK) {
+            reply += "Error: ";
+            appendInputError(reply, error, game.getColors());
+            reply += '\n';
+        } else {
+            Code guess = Code::fromString(guess_input);
+            Feedback fb = game.submit(guess);
+            session.trace.guesses.push_back(guess);
+            if (game.isWon()) {
+                reply += "WIN ";
+                appendNumber(game.getTurnsUsed());
+                reply += '\n';
+            } else {
+                reply += "HINT ";
+                reply += game.hintText(fb);
+                reply += ' ';
+                appendNumber(game.getTurnsLeft());
+                reply += '\n';
+                if (game.isOver()) {
+                    reply += "LOSE ";
+                    reply += game.getCode().toString();
+                    reply += '\n';
+                }
+            }
+            if (game.isOver()) {
+                lock_guard<mutex> guard(history.lock);
+                recordResult(game.getLength(), game.getColors(), 
+                             game.getDuplicateChoice(), game.isWon(), 
+                             game.getTurnsUsed(), history.results, &session.trace);
+            }
+        }
+    } else if (isCommand("STATS")) {
+        long wins = 0, losses = 0, games;
+        {
+            lock_guard<mutex> guard(history.lock);
+            for (int board = 0; board < numBoards; board++) {
+                const ConfigStats& config = history.results.getStats(board);
+                wins += config.wins;
+                losses += config.losses;
+            }
+            games = history.results.size();
+        }
+        reply += "STATS ";
+        appendNumber(games);
+        reply += ' ';
+        appendNumber(wins);
+        reply += ' ';
+        appendNumber(losses);
+        reply += '\n';
+    } else if (isCommand("QUIT")) {
+        reply += "BYE\n";
+        session.closing = true;
+    } else if (!command.empty()) {
+        reply += "Error: Unknown command. Use NEW, GUESS, STATS or QUIT.\n";
     }
 }
 
-void printInOrder(TreeNode* root) {
-    if (root != nullptr) {
-        printInOrder(root->left);
-        cout << "Code Length: " << root->result.codeLength << " - ";
-        cout << (root->result.duplicateSetting == 'y' ? "Duplicates" : "No duplicates");
-        cout << " - Result: " << (root->result.isWin ? "Win" : "Loss") << endl;
-        printInOrder(root->right);
+/************************************************************
+*    Reads what the client has sent and runs every complete 
+*    line. Clients that send overlong lines are dropped.
+***********************************************************/
+void ServerWorker::readFrom(ServerSession& session) {
+    const size_t maxLine = 256;
+    char buffer[4096];
+    ssize_t n;
+    
+    while ((n = read(session.fd, buffer, sizeof(buffer))) > 0) {
+        session.input.append(buffer, n);
+    }
+    if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+        session.closing = true;     // Client hung up or the socket failed
+        session.output.clear();
+        return;
+    }
+    
+    size_t start = 0, end;
+    while (!session.closing && 
+           (end = session.input.find('\n', start)) != string::npos) {
+        string_view line(session.input.data() + start, end - start);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        handleLine(session, line);
+        start = end + 1;
+    }
+    session.input.erase(0, start);
+    if (session.input.size() > maxLine) {
+        session.closing = true;
+        session.output.clear();
     }
 }
 
 /************************************************************
-*    Recursively traverses a binary tree to extract game 
-*    scores and their associated details into a vector of 
-*    pairs. This function prepares scores for further 
-*    processing, such as sorting or display.
+*    Sends as much queued output as the socket takes and 
+*    watches for writability only while some is left.
 ***********************************************************/
-void extractScores(TreeNode* root, vector<pair<string, int>>& scores) {
-    if (!root) return;
-
-    // Traverse the left subtree
-    extractScores(root->left, scores);
-
-    // Process the current node: Convert GameResult to a score format
-    string key = "Length: " + to_string(root->result.codeLength) + ", " + 
-                 (root->result.duplicateSetting == 'y' ? "Duplicates" : "No duplicates");
-    int value = root->result.isWin ? 1 : 0; // Example scoring: 1 for a win, 0 for a loss
-    scores.emplace_back(key, value);
-
-    // Traverse the right subtree
-    extractScores(root->right, scores);
-}
-
-void merge(vector<pair<string, int>>& scores, int left, int mid, int right) {
-    int n1 = mid - left + 1;
-    int n2 = right - mid;
-
-    vector<pair<string, int>> leftArr(scores.begin() + left, scores.begin() + mid + 1);
-    vector<pair<string, int>> rightArr(scores.begin() + mid + 1, scores.begin() + right + 1);
-
-    int i = 0, j = 0, k = left;
-    while (i < n1 && j < n2) {
-        if (leftArr[i].second >= rightArr[j].second) {
-            scores[k++] = leftArr[i++];
-        } else {
-            scores[k++] = rightArr[j++];
+void ServerWorker::flush(ServerSession& session) {
+    size_t sent = 0;
+    while (sent < session.output.size()) {
+        ssize_t n = send(session.fd, session.output.data() + sent, 
+                         session.output.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                session.output.clear();
+                session.closing = true;
+                return;
+            }
+            break;
         }
+        sent += n;
     }
-
-    while (i < n1) scores[k++] = leftArr[i++];
-    while (j < n2) scores[k++] = rightArr[j++];
+    session.output.erase(0, sent);
+    
+    epoll_event event = {};
+    event.events = session.output.empty() ? EPOLLIN : EPOLLIN | EPOLLOUT;
+    event.data.ptr = &session;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, session.fd, &event);
 }
 
-void mergeSort(vector<pair<string, int>>& scores, int left, int right) {
-    if (left < right) {
-        int mid = left + (right - left) / 2;
-        mergeSort(scores, left, mid);
-        mergeSort(scores, mid + 1, right);
-        merge(scores, left, mid, right);
-    }
+void ServerWorker::closeSession(ServerSession* session) {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, session->fd, nullptr);
+    close(session->fd);
+    sessions.erase(session->fd);
+    delete session;
 }
 
 /************************************************************
-*    Extracts and displays game scores from a binary tree 
-*    in sorted order. Provides a clear overview of scores 
-*    ranked by performance.
+*    The worker's event loop; returns once the server is 
+*    stopping.
 ***********************************************************/
-void printSortedScores(TreeNode* root) {
-    vector<pair<string, int>> scores;
-
-    // Extract scores from the tree
-    extractScores(root, scores);
-
-    // Sort the scores
-    mergeSort(scores, 0, scores.size() - 1);
-
-    // Print the sorted scores
-    cout << "SCORES IN POINTS ORDER:\n";
-    for (const auto& score : scores) {
-        cout << score.first << ", Points: " << score.second << endl;
+void ServerWorker::run() {
+    const int maxEvents = 256;
+    epoll_event events[maxEvents];
+    
+    while (!stopping) {
+        int ready = epoll_wait(epollFd, events, maxEvents, 200);
+        for (int i = 0; i < ready; i++) {
+            ServerSession* session = static_cast<ServerSession*>(events[i].data.ptr);
+            if (session == nullptr) {
+                registerPending();
+                continue;
+            }
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                readFrom(*session);
+            }
+            if (!session->output.empty()) {
+                flush(*session);
+            }
+            if (session->closing && session->output.empty()) {
+                closeSession(session);
+            }
+        }
     }
 }
 
-unsigned int RSHash(const list<char> str)
-{
-   unsigned int b    = 378551;
-   unsigned int a    = 63689;
-   unsigned int hash = 0;
+static atomic<bool> serverStopping(false);
 
-   for(auto i : str)
-   {
-      hash = hash * a + i;
-      a    = a * b;
-   }
+static void stopServer(int) {
+    serverStopping = true;
+}
 
-   return hash;
+/************************************************************
+*    Hosts many games at once over TCP on localhost:
+*      --serve <port> [workers]
+*    Clients send one command per line (see 
+*    `ServerWorker::handleLine`). The main thread accepts 
+*    connections and deals them out to the workers, one per 
+*    core by default. Every finished game is recorded in one 
+*    shared history; Ctrl-C stops the server and prints it.
+***********************************************************/
+int runServer(int argc, char* argv[]) {
+    if (argc < 3) {
+        cerr << "Usage: " << argv[0] << " --serve <port> [workers]" << endl;
+        return 1;
+    }
+    int port = atoi(argv[2]);
+    int numWorkers = (argc > 3) ? atoi(argv[3]) 
+                                : static_cast<int>(max(1u, thread::hardware_concurrency()));
+    if (port <= 0 || port > 65535 || numWorkers <= 0) {
+        cerr << "Error: invalid server settings." << endl;
+        return 1;
+    }
+    
+    int listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (listenFd < 0 || 
+        ::bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || 
+        listen(listenFd, SOMAXCONN) != 0) {
+        cerr << "Error: cannot listen on port " << port << ": " 
+             << strerror(errno) << endl;
+        if (listenFd >= 0) {
+            close(listenFd);
+        }
+        return 1;
+    }
+    
+    signal(SIGINT, stopServer);
+    signal(SIGTERM, stopServer);
+    
+    ServerHistory history;
+    uint64_t seed = static_cast<uint64_t>(time(0));
+    vector<unique_ptr<ServerWorker>> workers;
+    vector<thread> threads;
+    for (int id = 0; id < numWorkers; id++) {
+        workers.emplace_back(new ServerWorker(seed, id, history, serverStopping));
+    }
+    for (auto& worker : workers) {
+        threads.emplace_back(&ServerWorker::run, worker.get());
+    }
+    cout << "Serving Mastermind on 127.0.0.1:" << port << " with " 
+         << numWorkers << " workers. Press Ctrl-C to stop." << endl;
+    
+    size_t nextWorker = 0;
+    pollfd listener = {listenFd, POLLIN, 0};
+    while (!serverStopping) {
+        if (poll(&listener, 1, 200) <= 0) {
+            continue;
+        }
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK);
+        if (fd < 0) {
+            continue;
+        }
+        int noDelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        workers[nextWorker]->adopt(fd);
+        nextWorker = (nextWorker + 1) % workers.size();
+    }
+    
+    for (thread& t : threads) {
+        t.join();
+    }
+    close(listenFd);
+    
+    displayStatistics(history.results);
+    printSortedScores(history.results);
+    renderer.flush();
+    return 0;
 }
 
+#ifdef MASTERMIND_ALLOC_CHECK
+
 /************************************************************
-*    Displays the contents of a hash table, bucket by bucket.
-*    The output format makes the structure and contents of 
-*    the hash table clear and easy to understand.
+*    Counts, with the allocator hook, the heap allocations 
+*    each phase of a game makes and checks that a turn in 
+*    steady state makes none:
+*      --alloc-check [games] [--threads <n>]
+*    Plays `games` games (100 by default) on each of a few 
+*    boards, first through the calls a console game makes 
+*    (GameSession::start, checkGuess, compareGuess narrowing 
+*    the candidates) and then through the server's command 
+*    handler. The first game of each board sizes the reusable 
+*    buffers and is not counted. After it every turn 
+*    (validate, score, record) must make no allocations, or 
+*    the check fails with exit status 1. Starting a game may 
+*    still allocate now and then, as it makes room in the 
+*    history for the games to come and the hash table grows. 
+*    The boards and code seeds are fixed, so every run plays 
+*    the same games. Only in builds with the allocator hook; 
+*    check_allocations.sh builds one and runs the check.
 ***********************************************************/
-void printHashTable(const HashTable& hashTable) {
-    cout << "\nHash Table Contents:" << endl;
-    for (int i = 0; i < hashTable.getSize(); ++i) {
-        cout << "Bucket " << i;
-        auto &bucket = hashTable.getBucket(i); // Access the bucket at index `i`
-        if (!bucket.empty()) {
-            cout << " --> ";
+int runAllocCheck(int argc, char* argv[]) {
+    long games = 100;
+    int threads = static_cast<int>(max(1u, thread::hardware_concurrency()));
+    for (int arg = 2; arg < argc; arg++) {
+        if (strcmp(argv[arg], "--threads") == 0 && arg + 1 < argc) {
+            threads = atoi(argv[++arg]);
+        } else {
+            games = atol(argv[arg]);
+        }
+    }
+    if (games < 2 || threads < 1) {
+        cerr << "Usage: " << argv[0] << " --alloc-check [games] [--threads <n>]" 
+             << endl;
+        return 1;
+    }
+    
+    enum { START, REJECT, VALIDATE, TURN, LAST_TURN, SERVER_NEW, SERVER_GUESS, 
+           SERVER_LAST_GUESS, NUM_PHASES };
+    const char* names[NUM_PHASES] = {
+        "Start game", "Reject guess", "Validate guess", "Turn", "Last turn", 
+        "Server NEW", "Server GUESS", "Server last GUESS"
+    };
+    const bool mustBeZero[NUM_PHASES] = {false, true, true, true, true, 
+                                         false, true, true};
+    uint64_t calls[NUM_PHASES] = {0};
+    uint64_t allocations[NUM_PHASES] = {0};
+    bool counting = false;
+    
+    // Runs `body` as one call of `phase`
+    auto measure = [&](int phase, auto&& body) {
+        AllocationCounter counter;
+        body();
+        if (counting) {
+            calls[phase]++;
+            allocations[phase] += counter.count();
+        }
+    };
+    
+    struct Board {
+        int length;
+        int colors;
+        char choiceDuplicate;
+    };
+    const Board boards[] = {{4, 6, 'y'}, {5, 8, 'n'}, {6, 8, 'y'}};
+    
+    // Console games: the player always guesses the first code still possible
+    CodeGenerator generator(1);
+    ResultsIndex results;
+    HashTable hashTable(8);
+    CandidateSet candidates;
+    candidates.setThreads(threads);
+    GameSession session;
+    GameTrace trace;
+    string message;
+    for (const Board& board : boards) {
+        string tooLong(board.length + 1, '1');
+        for (long game = 0; game < games; game++) {
+            counting = game > 0;
+            measure(START, [&]() {
+                session.start(board.length, board.colors, board.choiceDuplicate, 
+                              generator);
+                hashTable.insert(session.getCode(), boardIndex(board.length, 
+                                 board.colors, board.choiceDuplicate));
+                results.reserve(board.length, board.colors, board.choiceDuplicate);
+                trace.begin();
+                candidates.reset(board.length, board.colors, board.choiceDuplicate);
+            });
+            while (session.isPlaying()) {
+                string guess_input = (*candidates.begin()).toString();
+                measure(REJECT, [&]() {
+                    message.clear();
+                    appendInputError(message, checkGuess(tooLong, board.length, 
+                                                         board.colors), 
+                                     board.colors);
+                });
+                InputError error = INPUT_OK;
+                measure(VALIDATE, [&]() {
+                    error = checkGuess(guess_input, board.length, board.colors);
+                });
+                if (error != INPUT_OK) {
+                    cerr << "Error: the player's guess " << guess_input 
+                         << " was rejected." << endl;
+                    return 1;
+                }
+                AllocationCounter counter;
+                compareGuess(session, guess_input, results, false, &candidates, 
+                             &trace);
+                if (counting) {
+                    int phase = session.isOver() ? LAST_TURN : TURN;
+                    calls[phase]++;
+                    allocations[phase] += counter.count();
+                }
+            }
         }
-        int j = 0;
-        for (const auto& innerList : bucket) {
-            for (char num : innerList) {
-                cout << num;
+    }
+    
+    // Server games: a few wrong guesses, then the code or a loss
+    ServerHistory history;
+    atomic<bool> stopping(false);
+    ServerWorker worker(1, 0, history, stopping);
+    ServerSession client(-1);
+    string line;
+    for (const Board& board : boards) {
+        for (long game = 0; game < games; game++) {
+            counting = game > 0;
+            line = "NEW ";
+            line += to_string(board.length) + ' ' + board.choiceDuplicate + ' ' + 
+                    to_string(board.colors);
+            measure(SERVER_NEW, [&]() {
+                worker.handleLine(client, line);
+            });
+            client.output.clear();
+            
+            const Code& secret = client.game.getCode();
+            string right = secret.toString();
+            string wrong = right;
+            if (board.choiceDuplicate == 'y') {
+                wrong[0] = Code::symbol((secret.peg(0) + 1) % board.colors);
+            } else {
+                swap(wrong[0], wrong[1]);   // Keeps the colors distinct
             }
-            j++;
-            if(j != bucket.size()){
-                cout << " --> ";
+            int misses = (game % 5 == 0) ? client.game.getTurnLimit() : game % 4;
+            for (int turn = 0; client.game.isPlaying(); turn++) {
+                line = "GUESS ";
+                line += (turn < misses) ? wrong : right;
+                AllocationCounter counter;
+                worker.handleLine(client, line);
+                if (counting) {
+                    int phase = client.game.isOver() ? SERVER_LAST_GUESS : SERVER_GUESS;
+                    calls[phase]++;
+                    allocations[phase] += counter.count();
+                }
+                client.output.clear();
             }
         }
-        cout << endl;
     }
-}
\ No newline at end of file
+    
+    bool passed = true;
+    cout << "Allocations per phase over " << games - 1 << " games on each of " 
+         << sizeof(boards) / sizeof(boards[0]) << " boards, " << threads 
+         << " threads:" << endl;
+    for (int phase = 0; phase < NUM_PHASES; phase++) {
+        cout << names[phase] << ": " << calls[phase] << " calls, " 
+             << allocations[phase] << " allocations (" 
+             << (calls[phase] ? static_cast<double>(allocations[phase]) / 
+                                calls[phase] : 0.0) 
+             << " per call)" << (mustBeZero[phase] ? ", must be 0" : "") << endl;
+        if (mustBeZero[phase] && allocations[phase] != 0) {
+            passed = false;
+        }
+    }
+    if (!passed) {
+        cout << "FAILED: a steady-state turn allocated." << endl;
+        return 1;
+    }
+    cout << "Passed: steady-state turns made no heap allocations." << endl;
+    return 0;
+}
+
+#endif
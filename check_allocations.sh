@@ -0,0 +1,18 @@
+#!/bin/sh
+# Builds the game with the allocation-counting hook and checks that a
+# steady-state turn (validate, score, record) makes no heap allocations,
+# on one thread and on four. Exits non-zero if any turn allocates.
+#
+#   ./check_allocations.sh [games]
+set -e
+
+dir=$(cd "$(dirname "$0")" && pwd)
+build=$(mktemp -d)
+trap 'rm -rf "$build"' EXIT
+
+${CXX:-g++} -std=c++17 -O2 -pthread -DMASTERMIND_ALLOC_CHECK \
+    "$dir/Mastermind_Recursion.cpp" -o "$build/mastermind"
+
+games=${1:-200}
+"$build/mastermind" --alloc-check "$games" --threads 1
+"$build/mastermind" --alloc-check "$games" --threads 4